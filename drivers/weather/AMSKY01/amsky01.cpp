@@ -16,15 +16,53 @@
 #include "indicom.h"
 #include "libindi/connectionplugins/connectionserial.h"
 #include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
 
+#include <chrono>
+#include <ctime>
 #include <memory>
 #include <string>
-#include <vector>
-#include <sstream>
 #include <iostream>
 
 static std::unique_ptr<AMSKY01> amsky01(new AMSKY01());
 
+static const char *DIAGNOSTICS_TAB = "Diagnostics";
+static const char *STATISTICS_TAB = "Statistics";
+
+// 10 frames per second for a whole UTC day
+static constexpr size_t ARCHIVE_ROWS_PER_DAY = 864000;
+
+// Parameters with sliding window statistics, one STATS_* vector each
+static const struct
+{
+    AMSKY01Protocol::Parameter parameter;
+    const char *name;
+    const char *label;
+} STATS_PARAMETERS[] =
+{
+    { AMSKY01Protocol::TEMPERATURE, "STATS_TEMPERATURE", "Temperature" },
+    { AMSKY01Protocol::HUMIDITY, "STATS_HUMIDITY", "Humidity" },
+    { AMSKY01Protocol::SKY_BRIGHTNESS, "STATS_SKY_BRIGHTNESS", "Sky Brightness" },
+    { AMSKY01Protocol::CLOUD_COVER, "STATS_CLOUD_COVER", "Cloud Cover" },
+};
+
+// amsky01_shm.h is plain C for readers, keep it in step with the schema
+static_assert(static_cast<int>(AMSKY01_SHM_PARAMETER_COUNT) == AMSKY01Protocol::PARAMETER_COUNT,
+              "amsky01_shm.h parameters out of date");
+static_assert(static_cast<int>(AMSKY01_SHM_CLOUD_COVER) == AMSKY01Protocol::CLOUD_COVER &&
+              static_cast<int>(AMSKY01_SHM_SKY_TEMP_5) == AMSKY01Protocol::SKY_TEMP_5,
+              "amsky01_shm.h parameter order differs");
+static_assert(AMSKY01_SHM_SENSOR_CLOUD == 1u << static_cast<int>(AMSKY01Protocol::SentenceType::CLOUD),
+              "amsky01_shm.h sensor bits differ");
+
 AMSKY01::AMSKY01()
 {
     setVersion(1, 0);
@@ -32,6 +70,7 @@ AMSKY01::AMSKY01()
 
 AMSKY01::~AMSKY01()
 {
+    stopIngest();
 }
 
 const char *AMSKY01::getDefaultName()
@@ -43,29 +82,16 @@ bool AMSKY01::initProperties()
 {
     INDI::Weather::initProperties();
 
-    // Add weather parameters podle AMSKY01 senzorů
-    addParameter("WEATHER_TEMPERATURE", "Temperature (°C)", -50, 80, 15);
-    addParameter("WEATHER_HUMIDITY", "Humidity (%)", 0, 100, 15);  
-    addParameter("WEATHER_DEW_POINT", "Dew Point (°C)", -50, 50, 15);
-    addParameter("WEATHER_LIGHT_LUX", "Light (lux)", 0, 100000, 15);
-    addParameter("WEATHER_SKY_BRIGHTNESS", "Sky Brightness (mag/arcsec²)", 10, 25, 15);
-    addParameter("WEATHER_CLOUD_COVER", "Cloud Cover (%)", 0, 100, 15);
-    addParameter("WEATHER_SKY_TEMPERATURE", "Sky Temperature Avg (ADU)", 60000, 70000, 15);
-    
-    // Individuální teploty ze sky senzoru (5 thermopile segmentů)
-    addParameter("WEATHER_SKY_TEMP_1", "Sky Temp 1 (ADU)", 60000, 70000, 15);
-    addParameter("WEATHER_SKY_TEMP_2", "Sky Temp 2 (ADU)", 60000, 70000, 15);
-    addParameter("WEATHER_SKY_TEMP_3", "Sky Temp 3 (ADU)", 60000, 70000, 15);
-    addParameter("WEATHER_SKY_TEMP_4", "Sky Temp 4 (ADU)", 60000, 70000, 15);
-    addParameter("WEATHER_SKY_TEMP_5", "Sky Temp 5 - Zenith (ADU)", 60000, 70000, 15);
-    
-    setCriticalParameter("WEATHER_TEMPERATURE");
-    setCriticalParameter("WEATHER_HUMIDITY");
-    setCriticalParameter("WEATHER_DEW_POINT");
-    setCriticalParameter("WEATHER_LIGHT_LUX");
-    setCriticalParameter("WEATHER_SKY_BRIGHTNESS");
-    setCriticalParameter("WEATHER_CLOUD_COVER");
-    setCriticalParameter("WEATHER_SKY_TEMPERATURE");
+    // Add weather parameters podle AMSKY01 senzorů, generated from the sentence schema
+    for (size_t i = 0; i < AMSKY01Protocol::PARAMETER_COUNT; i++)
+    {
+        const AMSKY01Protocol::ParameterSpec &spec = AMSKY01Protocol::PARAMETERS[i];
+        addParameter(spec.name, spec.label, spec.minOk, spec.maxOk, spec.percWarning);
+        parameterIndex[i] = ParametersNP.size() - 1;
+
+        if (spec.critical)
+            setCriticalParameter(spec.name);
+    }
 
     // Device info
     addDebugControl();
@@ -77,6 +103,316 @@ bool AMSKY01::initProperties()
     IUFillText(&StatusT[1], "STATUS", "Status", "Disconnected");
     IUFillTextVector(&StatusTP, StatusT, 2, getDeviceName(), "DEVICE_STATUS", "Device Status", MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
 
+    // Frame info - sequence number and time of the last published frame
+    IUFillNumber(&FrameN[FRAME_SEQUENCE], "FRAME_SEQUENCE", "Sequence", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&FrameN[FRAME_TIMESTAMP], "FRAME_TIMESTAMP", "Timestamp (s)", "%.3f", 0, 1e12, 0, 0);
+    IUFillNumber(&FrameN[FRAME_SENSORS], "FRAME_SENSORS", "Sensors Updated", "%.f", 0, AMSKY01Protocol::SENTENCE_COUNT, 0, 0);
+    IUFillNumberVector(&FrameNP, FrameN, 3, getDeviceName(), "WEATHER_FRAME", "Weather Frame",
+                       MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Publish an incomplete frame when a sensor cycle takes longer than this
+    IUFillNumber(&FrameDeadlineN[0], "DEADLINE_MS", "Deadline (ms)", "%.f", 10, 60000, 100, 2000);
+    IUFillNumberVector(&FrameDeadlineNP, FrameDeadlineN, 1, getDeviceName(), "FRAME_DEADLINE", "Frame Deadline",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Publication filter, one deadband element per weather parameter
+    for (size_t i = 0; i < AMSKY01Protocol::PARAMETER_COUNT; i++)
+    {
+        const AMSKY01Protocol::ParameterSpec &spec = AMSKY01Protocol::PARAMETERS[i];
+        double span = spec.maxOk - spec.minOk;
+        IUFillNumber(&DeadbandAbsN[i], spec.name, spec.label, "%.3f", 0, span, span / 1000, 0);
+        IUFillNumber(&DeadbandRelN[i], spec.name, spec.label, "%.2f", 0, 100, 0.1, 0);
+    }
+    IUFillNumberVector(&DeadbandAbsNP, DeadbandAbsN, AMSKY01Protocol::PARAMETER_COUNT, getDeviceName(),
+                       "PUBLISH_DEADBAND_ABS", "Deadband (units)", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumberVector(&DeadbandRelNP, DeadbandRelN, AMSKY01Protocol::PARAMETER_COUNT, getDeviceName(),
+                       "PUBLISH_DEADBAND_REL", "Deadband (%)", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillNumber(&MaxSilenceN[0], "MAX_SILENCE", "Max Silence (s)", "%.f", 0, 3600, 10, 60);
+    IUFillNumberVector(&MaxSilenceNP, MaxSilenceN, 1, getDeviceName(), "PUBLISH_SILENCE", "Republish",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    publishFilter.resize(AMSKY01Protocol::PARAMETER_COUNT);
+    applyPublishFilterSettings();
+
+    // Sensor freshness - a sensor silent for longer than its timeout is stale
+    char elementName[MAXINDINAME], elementLabel[MAXINDILABEL];
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+    {
+        const AMSKY01Protocol::SentenceSpec &spec = AMSKY01Protocol::SENTENCES[i];
+        IUFillLight(&SensorFreshL[i], spec.sensorName, spec.sensorLabel, IPS_IDLE);
+        IUFillNumber(&SensorTimeoutN[i], spec.sensorName, spec.sensorLabel, "%.f", 1, 3600, 1, 30);
+
+        static const char *timingNames[TIMING_COUNT] = { "AGE", "INTERVAL_MEAN", "INTERVAL_STDDEV", "INTERVAL_MAX" };
+        static const char *timingLabels[TIMING_COUNT] = { "Age (s)", "Interval (s)", "Interval Stddev (s)", "Interval Max (s)" };
+        for (size_t j = 0; j < TIMING_COUNT; j++)
+        {
+            snprintf(elementName, sizeof(elementName), "%s_%s", spec.sensorName, timingNames[j]);
+            snprintf(elementLabel, sizeof(elementLabel), "%s %s", spec.sensorLabel, timingLabels[j]);
+            IUFillNumber(&SensorTimingN[i * TIMING_COUNT + j], elementName, elementLabel, "%.3f", 0, 1e9, 0, 0);
+        }
+    }
+    IUFillLightVector(&SensorFreshLP, SensorFreshL, AMSKY01Protocol::SENTENCE_COUNT, getDeviceName(),
+                      "SENSOR_FRESHNESS", "Sensors", MAIN_CONTROL_TAB, IPS_IDLE);
+    IUFillNumberVector(&SensorTimeoutNP, SensorTimeoutN, AMSKY01Protocol::SENTENCE_COUNT, getDeviceName(),
+                       "SENSOR_TIMEOUT", "Sensor Timeout (s)", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumberVector(&SensorTimingNP, SensorTimingN, AMSKY01Protocol::SENTENCE_COUNT * TIMING_COUNT, getDeviceName(),
+                       "SENSOR_TIMING", "Sensor Timing", DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Latency diagnostics
+    static const char *stageNames[STAGE_COUNT] = { "READ_PARSE", "PARSE_PUBLISH", "READ_PUBLISH" };
+    static const char *stageLabels[STAGE_COUNT] = { "Read→Parse", "Parse→Publish", "Read→Publish" };
+    static const char *statNames[3] = { "P50", "P99", "MAX" };
+    for (size_t i = 0; i < STAGE_COUNT; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            snprintf(elementName, sizeof(elementName), "%s_%s", stageNames[i], statNames[j]);
+            snprintf(elementLabel, sizeof(elementLabel), "%s %s (µs)", stageLabels[i], statNames[j]);
+            IUFillNumber(&LatencyN[i * 3 + j], elementName, elementLabel, "%.1f", 0, 1e12, 0, 0);
+        }
+    }
+    IUFillNumberVector(&LatencyNP, LatencyN, STAGE_COUNT * 3, getDeviceName(), "LATENCY", "Latency",
+                       DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    IUFillSwitch(&LatencyResetS[0], "RESET", "Reset", ISS_OFF);
+    IUFillSwitchVector(&LatencyResetSP, LatencyResetS, 1, getDeviceName(), "LATENCY_RESET", "Latency",
+                       DIAGNOSTICS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+
+    // Stream health
+    static const char *healthNames[HEALTH_PER_SENTENCE] = { "PARSED", "MALFORMED", "RATE" };
+    static const char *healthLabels[HEALTH_PER_SENTENCE] = { "parsed", "malformed", "lines/s" };
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+    {
+        for (size_t j = 0; j < HEALTH_PER_SENTENCE; j++)
+        {
+            snprintf(elementName, sizeof(elementName), "%s_%s", AMSKY01Protocol::SENTENCES[i].sensorName, healthNames[j]);
+            snprintf(elementLabel, sizeof(elementLabel), "%s %s", AMSKY01Protocol::SENTENCES[i].sensorLabel, healthLabels[j]);
+            IUFillNumber(&StreamHealthN[i * HEALTH_PER_SENTENCE + j], elementName, elementLabel,
+                         j == HEALTH_RATE ? "%.2f" : "%.f", 0, 1e18, 0, 0);
+        }
+    }
+    INumber *streamWide = &StreamHealthN[AMSKY01Protocol::SENTENCE_COUNT * HEALTH_PER_SENTENCE];
+    IUFillNumber(&streamWide[HEALTH_UNKNOWN_TAG], "UNKNOWN_TAG", "Unknown tag", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&streamWide[HEALTH_NOT_SENTENCE], "NOT_SENTENCE", "Without $", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&streamWide[HEALTH_TRUNCATED], "TRUNCATED", "Truncated", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&streamWide[HEALTH_BYTES_READ], "BYTES_READ", "Bytes read", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&streamWide[HEALTH_REPLIES], "REPLIES", "Command replies", "%.f", 0, 1e18, 0, 0);
+    IUFillNumberVector(&StreamHealthNP, StreamHealthN, AMSKY01Protocol::SENTENCE_COUNT * HEALTH_PER_SENTENCE + 5,
+                       getDeviceName(), "STREAM_HEALTH", "Stream Health", DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Sliding window statistics
+    static const double defaultWindows[STATS_WINDOW_COUNT] = { 1, 5, 15 };
+    for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+    {
+        snprintf(elementName, sizeof(elementName), "WINDOW_%zu", w + 1);
+        snprintf(elementLabel, sizeof(elementLabel), "Window %zu (min)", w + 1);
+        IUFillNumber(&StatsWindowsN[w], elementName, elementLabel, "%.1f", 0.1, 1440, 1, defaultWindows[w]);
+    }
+    IUFillNumberVector(&StatsWindowsNP, StatsWindowsN, STATS_WINDOW_COUNT, getDeviceName(), "STATS_WINDOWS",
+                       "Windows", STATISTICS_TAB, IP_RW, 60, IPS_IDLE);
+
+    static_assert(sizeof(STATS_PARAMETERS) / sizeof(STATS_PARAMETERS[0]) == STATS_PARAMETER_COUNT,
+                  "one STATS_PARAMETERS row per StatsNP vector");
+    static const char *statsNames[STATS_PER_WINDOW] = { "MIN", "MAX", "MEAN", "STDDEV" };
+    static const char *statsLabels[STATS_PER_WINDOW] = { "min", "max", "mean", "stddev" };
+    for (int &slot : statsSlot)
+        slot = -1;
+    for (size_t p = 0; p < STATS_PARAMETER_COUNT; p++)
+    {
+        statsSlot[STATS_PARAMETERS[p].parameter] = static_cast<int>(p);
+        for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+        {
+            for (size_t j = 0; j < STATS_PER_WINDOW; j++)
+            {
+                snprintf(elementName, sizeof(elementName), "W%zu_%s", w + 1, statsNames[j]);
+                snprintf(elementLabel, sizeof(elementLabel), "W%zu %s", w + 1, statsLabels[j]);
+                IUFillNumber(&StatsN[p][w * STATS_PER_WINDOW + j], elementName, elementLabel, "%.2f", -1e9, 1e9, 0, 0);
+            }
+        }
+        IUFillNumberVector(&StatsNP[p], StatsN[p], STATS_WINDOW_COUNT * STATS_PER_WINDOW, getDeviceName(),
+                           STATS_PARAMETERS[p].name, STATS_PARAMETERS[p].label, STATISTICS_TAB, IP_RO, 60, IPS_IDLE);
+    }
+
+    // Night quantiles
+    static const char *nightNames[NIGHT_PARAMETER_COUNT] = { "SKY_BRIGHTNESS", "CLOUD_COVER" };
+    static const char *nightLabels[NIGHT_PARAMETER_COUNT] = { "SQM", "Cloud" };
+    static const double quantiles[NIGHT_QUANTILE_COUNT] = { 0.1, 0.5, 0.9 };
+    for (size_t p = 0; p < NIGHT_PARAMETER_COUNT; p++)
+    {
+        for (size_t q = 0; q < NIGHT_QUANTILE_COUNT; q++)
+        {
+            int percent = static_cast<int>(quantiles[q] * 100);
+            snprintf(elementName, sizeof(elementName), "%s_P%d", nightNames[p], percent);
+            snprintf(elementLabel, sizeof(elementLabel), "%s %d%%", nightLabels[p], percent);
+            IUFillNumber(&NightQuantilesN[p * NIGHT_QUANTILE_COUNT + q], elementName, elementLabel, "%.2f", -1e9, 1e9, 0, 0);
+            nightQuantiles[p][q].setQuantile(quantiles[q]);
+        }
+    }
+    IUFillNumber(&NightQuantilesN[NIGHT_PARAMETER_COUNT * NIGHT_QUANTILE_COUNT], "SAMPLES", "Samples (SQM + cloud)", "%.f", 0, 1e18, 0, 0);
+    IUFillNumberVector(&NightQuantilesNP, NightQuantilesN, NIGHT_PARAMETER_COUNT * NIGHT_QUANTILE_COUNT + 1, getDeviceName(),
+                       "NIGHT_QUANTILES", "Night", STATISTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    IUFillSwitch(&NightResetS[0], "RESET", "Reset", ISS_OFF);
+    IUFillSwitchVector(&NightResetSP, NightResetS, 1, getDeviceName(), "NIGHT_QUANTILES_RESET", "Night",
+                       STATISTICS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+
+    // Rollup history
+    history.resize(AMSKY01Protocol::PARAMETER_COUNT);
+    for (size_t t = 0; t < RollupHistory::TIER_COUNT; t++)
+    {
+        snprintf(elementName, sizeof(elementName), "TIER_%s", RollupHistory::TIERS[t].name);
+        snprintf(elementLabel, sizeof(elementLabel), "%s rollups (h)", RollupHistory::TIERS[t].name);
+        IUFillNumber(&HistorySpanN[t], elementName, elementLabel, "%.2f", 0, 1e6, 0, 0);
+    }
+    IUFillNumberVector(&HistorySpanNP, HistorySpanN, RollupHistory::TIER_COUNT, getDeviceName(), "HISTORY_SPAN",
+                       "History", STATISTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    for (size_t t = 0; t < RollupHistory::TIER_COUNT; t++)
+    {
+        snprintf(elementName, sizeof(elementName), "TIER_%s", RollupHistory::TIERS[t].name);
+        snprintf(elementLabel, sizeof(elementLabel), "%s rollups", RollupHistory::TIERS[t].name);
+        IUFillSwitch(&HistoryExportS[t], elementName, elementLabel, ISS_OFF);
+    }
+    IUFillSwitchVector(&HistoryExportSP, HistoryExportS, RollupHistory::TIER_COUNT, getDeviceName(), "HISTORY_EXPORT",
+                       "Export", STATISTICS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    IUFillSwitch(&HistoryCompressS[HISTORY_COMPRESS_ON], "ENABLE", "Compress", ISS_ON);
+    IUFillSwitch(&HistoryCompressS[HISTORY_COMPRESS_OFF], "DISABLE", "Raw", ISS_OFF);
+    IUFillSwitchVector(&HistoryCompressSP, HistoryCompressS, 2, getDeviceName(), "HISTORY_COMPRESS", "Export",
+                       STATISTICS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillBLOB(&HistoryB[0], "HISTORY", "History", ".amsh");
+    IUFillBLOBVector(&HistoryBP, HistoryB, 1, getDeviceName(), "HISTORY", "History", STATISTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Simulator, only defined in simulation
+    static const char *scenarioNames[AMSKY01Protocol::Simulator::SCENARIO_COUNT] =
+    { "CLEAR", "CLOUDING", "DEW", "TWILIGHT", "DROPOUTS" };
+    static const char *scenarioLabels[AMSKY01Protocol::Simulator::SCENARIO_COUNT] =
+    { "Clear", "Clear→Cloudy", "Dew", "Twilight", "Dropouts" };
+    for (size_t i = 0; i < AMSKY01Protocol::Simulator::SCENARIO_COUNT; i++)
+        IUFillSwitch(&SimScenarioS[i], scenarioNames[i], scenarioLabels[i], i == 0 ? ISS_ON : ISS_OFF);
+    IUFillSwitchVector(&SimScenarioSP, SimScenarioS, AMSKY01Protocol::Simulator::SCENARIO_COUNT, getDeviceName(),
+                       "SIM_SCENARIO", "Scenario", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&SimSettingsN[SIM_RATE], "RATE", "Lines/s", "%.f",
+                 AMSKY01Protocol::Simulator::MIN_RATE, AMSKY01Protocol::Simulator::MAX_RATE, 10, 10);
+    IUFillNumber(&SimSettingsN[SIM_PERIOD], "PERIOD", "Scenario period (s)", "%.f", 10, 86400, 60, 600);
+    IUFillNumberVector(&SimSettingsNP, SimSettingsN, 2, getDeviceName(), "SIM_SETTINGS", "Simulator",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Raw stream capture
+    IUFillSwitch(&CaptureS[CAPTURE_ENABLE], "ENABLE", "Record", ISS_OFF);
+    IUFillSwitch(&CaptureS[CAPTURE_DISABLE], "DISABLE", "Off", ISS_ON);
+    IUFillSwitchVector(&CaptureSP, CaptureS, 2, getDeviceName(), "RAW_CAPTURE", "Raw Capture",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillText(&CaptureFileT[0], "PATH", "File", "");
+    IUFillTextVector(&CaptureFileTP, CaptureFileT, 1, getDeviceName(), "RAW_CAPTURE_FILE", "Capture File",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Replay, only defined in simulation
+    IUFillSwitch(&ReplayS[REPLAY_ENABLE], "ENABLE", "Play", ISS_OFF);
+    IUFillSwitch(&ReplayS[REPLAY_DISABLE], "DISABLE", "Off", ISS_ON);
+    IUFillSwitchVector(&ReplaySP, ReplayS, 2, getDeviceName(), "RAW_REPLAY", "Replay",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillText(&ReplayFileT[0], "PATH", "File", "");
+    IUFillTextVector(&ReplayFileTP, ReplayFileT, 1, getDeviceName(), "RAW_REPLAY_FILE", "Replay File",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumber(&ReplaySpeedN[0], "SPEED", "Speed (0 = max)", "%.1f", 0, 10000, 1, 1);
+    IUFillNumberVector(&ReplaySpeedNP, ReplaySpeedN, 1, getDeviceName(), "RAW_REPLAY_SPEED", "Replay Speed",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Shared-memory snapshot
+    IUFillSwitch(&SharedSnapshotS[SHARED_ENABLE], "ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&SharedSnapshotS[SHARED_DISABLE], "DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&SharedSnapshotSP, SharedSnapshotS, 2, getDeviceName(), "SHM_SNAPSHOT", "Shared Memory",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillText(&SharedNameT[0], "NAME", "Segment", AMSKY01_SHM_DEFAULT_NAME);
+    IUFillTextVector(&SharedNameTP, SharedNameT, 1, getDeviceName(), "SHM_NAME", "Shared Memory",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Local JSON feed
+    IUFillSwitch(&FeedS[FEED_ENABLE], "ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&FeedS[FEED_DISABLE], "DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&FeedSP, FeedS, 2, getDeviceName(), "DATA_FEED", "Data Feed",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillText(&FeedPathT[0], "PATH", "Socket", "/tmp/indi_amsky01.sock");
+    IUFillTextVector(&FeedPathTP, FeedPathT, 1, getDeviceName(), "DATA_FEED_PATH", "Data Feed",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumber(&FeedStatusN[FEED_SUBSCRIBERS], "SUBSCRIBERS", "Subscribers", "%.f", 0, 1e6, 0, 0);
+    IUFillNumber(&FeedStatusN[FEED_DROPPED], "DROPPED", "Dropped lines", "%.f", 0, 1e18, 0, 0);
+    IUFillNumberVector(&FeedStatusNP, FeedStatusN, 2, getDeviceName(), "DATA_FEED_STATUS", "Data Feed",
+                       DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Device command
+    IUFillText(&DeviceCommandT[0], "COMMAND", "Command", "");
+    IUFillTextVector(&DeviceCommandTP, DeviceCommandT, 1, getDeviceName(), "DEVICE_COMMAND", "Device Command",
+                     DIAGNOSTICS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillText(&DeviceReplyT[0], "REPLY", "Reply", "");
+    IUFillTextVector(&DeviceReplyTP, DeviceReplyT, 1, getDeviceName(), "DEVICE_REPLY", "Device Command",
+                     DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Cloud onset
+    IUFillLight(&CloudOnsetL[0], "CLOUDS_ARRIVING", "Clouds arriving", IPS_IDLE);
+    IUFillLightVector(&CloudOnsetLP, CloudOnsetL, 1, getDeviceName(), "CLOUD_ONSET", "Cloud Onset",
+                      MAIN_CONTROL_TAB, IPS_IDLE);
+    IUFillNumber(&CloudOnsetN[ONSET_DRIFT], "DRIFT", "Ignored shift (σ)", "%.2f", 0, 10, 0.1, 1);
+    IUFillNumber(&CloudOnsetN[ONSET_THRESHOLD], "THRESHOLD", "Threshold (σ)", "%.1f", 0.5, 100, 0.5, 8);
+    IUFillNumber(&CloudOnsetN[ONSET_BASELINE], "BASELINE", "Baseline (samples)", "%.f", 10, 100000, 10, 300);
+    IUFillNumberVector(&CloudOnsetNP, CloudOnsetN, 3, getDeviceName(), "CLOUD_ONSET_SETTINGS", "Cloud Onset",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillSwitch(&CloudOnsetSafetyS[ONSET_SAFETY_ENABLE], "ENABLE", "Alert cloud cover", ISS_OFF);
+    IUFillSwitch(&CloudOnsetSafetyS[ONSET_SAFETY_DISABLE], "DISABLE", "Light only", ISS_ON);
+    IUFillSwitchVector(&CloudOnsetSafetySP, CloudOnsetSafetyS, 2, getDeviceName(), "CLOUD_ONSET_SAFETY", "Cloud Onset",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    for (size_t i = 0; i < AMSKY01Protocol::CLOUD_SEGMENTS; i++)
+    {
+        snprintf(elementName, sizeof(elementName), "SEGMENT_%zu", i + 1);
+        snprintf(elementLabel, sizeof(elementLabel), "Segment %zu", i + 1);
+        IUFillNumber(&CloudOnsetScoreN[i], elementName, elementLabel, "%.2f", 0, 1e3, 0, 0);
+    }
+    IUFillNumberVector(&CloudOnsetScoreNP, CloudOnsetScoreN, AMSKY01Protocol::CLOUD_SEGMENTS, getDeviceName(),
+                       "CLOUD_ONSET_SCORE", "Cloud Onset", DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Columnar archive
+    IUFillSwitch(&ArchiveS[ARCHIVE_ENABLE], "ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&ArchiveS[ARCHIVE_DISABLE], "DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&ArchiveSP, ArchiveS, 2, getDeviceName(), "ARCHIVE", "Archive",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    const char *home = getenv("HOME");
+    std::string archiveDir = std::string(home ? home : "/tmp") + "/.indi/amsky01_archive";
+    IUFillText(&ArchiveDirT[0], "DIR", "Directory", archiveDir.c_str());
+    IUFillTextVector(&ArchiveDirTP, ArchiveDirT, 1, getDeviceName(), "ARCHIVE_DIR", "Archive",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumber(&ArchiveStatusN[ARCHIVE_ROWS], "ROWS", "Rows today", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&ArchiveStatusN[ARCHIVE_DROPPED], "DROPPED", "Dropped rows", "%.f", 0, 1e18, 0, 0);
+    IUFillNumberVector(&ArchiveStatusNP, ArchiveStatusN, 2, getDeviceName(), "ARCHIVE_STATUS", "Archive",
+                       DIAGNOSTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Warm start
+    IUFillSwitch(&WarmStartS[WARM_START_ENABLE], "ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&WarmStartS[WARM_START_DISABLE], "DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&WarmStartSP, WarmStartS, 2, getDeviceName(), "WARM_START", "Warm Start",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    std::string warmStateFile = std::string(home ? home : "/tmp") + "/.indi/amsky01_state.bin";
+    IUFillText(&WarmStartFileT[0], "FILE", "File", warmStateFile.c_str());
+    IUFillTextVector(&WarmStartFileTP, WarmStartFileT, 1, getDeviceName(), "WARM_START_FILE", "Warm Start",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumber(&WarmStartN[WARM_INTERVAL], "INTERVAL", "Save every (s)", "%.f", 1, 3600, 1, 10);
+    IUFillNumber(&WarmStartN[WARM_MAX_AGE], "MAX_AGE", "Restore if newer than (min)", "%.f", 1, 10080, 1, 30);
+    IUFillNumberVector(&WarmStartNP, WarmStartN, 2, getDeviceName(), "WARM_START_SETTINGS", "Warm Start",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    // Serial reader mode - main loop or dedicated thread
+    IUFillSwitch(&ReaderModeS[READER_MAIN_LOOP], "MAIN_LOOP", "Main Loop", ISS_ON);
+    IUFillSwitch(&ReaderModeS[READER_THREAD], "THREAD", "Reader Thread", ISS_OFF);
+    IUFillSwitchVector(&ReaderModeSP, ReaderModeS, 2, getDeviceName(), "READER_MODE", "Serial Reader",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&ReaderQueueN[QUEUE_DEPTH], "QUEUE_DEPTH", "Depth", "%.f", 0, 1e9, 0, 0);
+    IUFillNumber(&ReaderQueueN[QUEUE_HIGH_WATER], "QUEUE_HIGH_WATER", "High Water", "%.f", 0, 1e9, 0, 0);
+    IUFillNumber(&ReaderQueueN[QUEUE_OVERFLOWS], "QUEUE_OVERFLOWS", "Overflows", "%.f", 0, 1e18, 0, 0);
+    IUFillNumberVector(&ReaderQueueNP, ReaderQueueN, 3, getDeviceName(), "READER_QUEUE", "Reader Queue",
+                       OPTIONS_TAB, IP_RO, 60, IPS_IDLE);
+
     // Add standard controls
     addAuxControls();
 
@@ -91,6 +427,79 @@ bool AMSKY01::updateProperties()
     {
         // Add properties when connected
         defineProperty(&StatusTP);
+        defineProperty(&FrameNP);
+        defineProperty(&FrameDeadlineNP);
+        loadConfig(true, FrameDeadlineNP.name);
+        defineProperty(&DeadbandAbsNP);
+        defineProperty(&DeadbandRelNP);
+        defineProperty(&MaxSilenceNP);
+        loadConfig(true, DeadbandAbsNP.name);
+        loadConfig(true, DeadbandRelNP.name);
+        loadConfig(true, MaxSilenceNP.name);
+        defineProperty(&SensorFreshLP);
+        defineProperty(&SensorTimeoutNP);
+        loadConfig(true, SensorTimeoutNP.name);
+        defineProperty(&SensorTimingNP);
+        defineProperty(&LatencyNP);
+        defineProperty(&LatencyResetSP);
+        defineProperty(&StreamHealthNP);
+        defineProperty(&StatsWindowsNP);
+        loadConfig(true, StatsWindowsNP.name);
+        for (auto &statsVector : StatsNP)
+            defineProperty(&statsVector);
+        defineProperty(&NightQuantilesNP);
+        defineProperty(&HistorySpanNP);
+        defineProperty(&HistoryExportSP);
+        defineProperty(&HistoryCompressSP);
+        defineProperty(&HistoryBP);
+        loadConfig(true, HistoryCompressSP.name);
+        defineProperty(&NightResetSP);
+        defineProperty(&CloudOnsetLP);
+        defineProperty(&CloudOnsetNP);
+        defineProperty(&CloudOnsetSafetySP);
+        defineProperty(&CloudOnsetScoreNP);
+        loadConfig(true, CloudOnsetNP.name);
+        loadConfig(true, CloudOnsetSafetySP.name);
+        defineProperty(&ReaderModeSP);
+        defineProperty(&ReaderQueueNP);
+        loadConfig(true, ReaderModeSP.name);
+        defineProperty(&SharedSnapshotSP);
+        defineProperty(&SharedNameTP);
+        loadConfig(true, SharedNameTP.name);
+        loadConfig(true, SharedSnapshotSP.name);
+        defineProperty(&FeedSP);
+        defineProperty(&FeedPathTP);
+        defineProperty(&FeedStatusNP);
+        defineProperty(&DeviceCommandTP);
+        defineProperty(&DeviceReplyTP);
+        loadConfig(true, FeedPathTP.name);
+        loadConfig(true, FeedSP.name);
+        defineProperty(&CaptureSP);
+        defineProperty(&CaptureFileTP);
+        loadConfig(true, CaptureFileTP.name);
+        defineProperty(&ArchiveSP);
+        defineProperty(&ArchiveDirTP);
+        defineProperty(&ArchiveStatusNP);
+        loadConfig(true, ArchiveDirTP.name);
+        loadConfig(true, ArchiveSP.name);
+        defineProperty(&WarmStartSP);
+        defineProperty(&WarmStartFileTP);
+        defineProperty(&WarmStartNP);
+        loadConfig(true, WarmStartFileTP.name);
+        loadConfig(true, WarmStartNP.name);
+        loadConfig(true, WarmStartSP.name);
+        if (isSimulation())
+        {
+            defineProperty(&SimScenarioSP);
+            defineProperty(&SimSettingsNP);
+            loadConfig(true, SimScenarioSP.name);
+            loadConfig(true, SimSettingsNP.name);
+            defineProperty(&ReplaySP);
+            defineProperty(&ReplayFileTP);
+            defineProperty(&ReplaySpeedNP);
+            loadConfig(true, ReplayFileTP.name);
+            loadConfig(true, ReplaySpeedNP.name);
+        }
         
         // Update status and start automatic data reading
         IUSaveText(&StatusT[1], "Connected - Auto Reading");
@@ -100,13 +509,106 @@ bool AMSKY01::updateProperties()
         printf("[AMSKY01] Device connected - starting automatic data reading\n");
         std::cout.flush();
         
-        // Start continuous data reading
-        SetTimer(100); // Read every 100ms
+        // Serial data is read from the event loop, the timer drives
+        // housekeeping and the simulated data source
+        frames.reset();
+        publishFilter.reset();
+        for (auto &sensor : sensors)
+        {
+            sensor.lastReceived = 0;
+            sensor.lastWall = 0;
+            sensor.stale = false;
+            sensor.restored = false;
+            sensor.intervals.reset();
+        }
+        safetyStates.clear();
+        resolveSafetyLights();
+        snapshot = amsky01_shm_snapshot();
+        if (SharedSnapshotS[SHARED_ENABLE].s == ISS_ON && sharedSnapshot == nullptr)
+            openSharedSnapshot();
+        if (FeedS[FEED_ENABLE].s == ISS_ON && feed.listenFD() < 0)
+            startFeed();
+        if (ArchiveS[ARCHIVE_ENABLE].s == ISS_ON && !archive.isOpen())
+            startArchive();
+        streamCounters.reset();
+        for (auto &parsed : healthParsed)
+            parsed = 0;
+        lastHealthUpdate = 0;
+        applyCloudOnsetSettings();
+        cloudOnset.reset();
+        CloudOnsetLP.s = IPS_IDLE;
+        CloudOnsetL[0].s = IPS_IDLE;
+        applyStatsWindows();
+        warmDirty = false;
+        warmStateError = 0;
+        if (WarmStartS[WARM_START_ENABLE].s == ISS_ON)
+            restoreWarmState();
+        startIngest();
+        SetTimer(getCurrentPollingPeriod());
     }
     else
     {
+        stopIngest();
+        closeSharedSnapshot();
+        stopFeed();
+        archive.close();
+        if (warmDirty && WarmStartS[WARM_START_ENABLE].s == ISS_ON)
+            storeWarmState();
+        if (capture.isOpen())
+        {
+            capture.close();
+            IUResetSwitch(&CaptureSP);
+            CaptureS[CAPTURE_DISABLE].s = ISS_ON;
+        }
+
         // Remove properties when disconnected
         deleteProperty(StatusTP.name);
+        deleteProperty(FrameNP.name);
+        deleteProperty(FrameDeadlineNP.name);
+        deleteProperty(DeadbandAbsNP.name);
+        deleteProperty(DeadbandRelNP.name);
+        deleteProperty(MaxSilenceNP.name);
+        deleteProperty(SensorFreshLP.name);
+        deleteProperty(SensorTimeoutNP.name);
+        deleteProperty(SensorTimingNP.name);
+        deleteProperty(LatencyNP.name);
+        deleteProperty(LatencyResetSP.name);
+        deleteProperty(StreamHealthNP.name);
+        deleteProperty(StatsWindowsNP.name);
+        for (auto &statsVector : StatsNP)
+            deleteProperty(statsVector.name);
+        deleteProperty(NightQuantilesNP.name);
+        deleteProperty(HistorySpanNP.name);
+        deleteProperty(HistoryExportSP.name);
+        deleteProperty(HistoryCompressSP.name);
+        deleteProperty(HistoryBP.name);
+        deleteProperty(NightResetSP.name);
+        deleteProperty(CloudOnsetLP.name);
+        deleteProperty(CloudOnsetNP.name);
+        deleteProperty(CloudOnsetSafetySP.name);
+        deleteProperty(CloudOnsetScoreNP.name);
+        deleteProperty(ReaderModeSP.name);
+        deleteProperty(ReaderQueueNP.name);
+        deleteProperty(SimScenarioSP.name);
+        deleteProperty(SimSettingsNP.name);
+        deleteProperty(SharedSnapshotSP.name);
+        deleteProperty(SharedNameTP.name);
+        deleteProperty(FeedSP.name);
+        deleteProperty(FeedPathTP.name);
+        deleteProperty(FeedStatusNP.name);
+        deleteProperty(DeviceCommandTP.name);
+        deleteProperty(DeviceReplyTP.name);
+        deleteProperty(ArchiveSP.name);
+        deleteProperty(ArchiveDirTP.name);
+        deleteProperty(ArchiveStatusNP.name);
+        deleteProperty(WarmStartSP.name);
+        deleteProperty(WarmStartFileTP.name);
+        deleteProperty(WarmStartNP.name);
+        deleteProperty(CaptureSP.name);
+        deleteProperty(CaptureFileTP.name);
+        deleteProperty(ReplaySP.name);
+        deleteProperty(ReplayFileTP.name);
+        deleteProperty(ReplaySpeedNP.name);
         
         printf("[AMSKY01] Device disconnected\n");
         std::cout.flush();
@@ -115,340 +617,1908 @@ bool AMSKY01::updateProperties()
     return true;
 }
 
-bool AMSKY01::Handshake()
+bool AMSKY01::Disconnect()
 {
-    if (isSimulation())
-    {
-        LOGF_INFO("Connected successfully to simulated %s.", getDeviceName());
-        return true;
-    }
-
-    // Weather base class handles connection management
-    // Just confirm connection is ready
-    LOGF_INFO("Connected successfully to %s.", getDeviceName());
-    
-    return true;
+    // Unregister PortFD before the base class closes it
+    stopIngest();
+    return INDI::Weather::Disconnect();
 }
 
-bool AMSKY01::sendCommand(const char *cmd)
+void AMSKY01::startIngest()
 {
-    int nbytes_read = 0, nbytes_written = 0, tty_rc = 0;
-    char res[256] = {0};
-    LOGF_DEBUG("CMD <%s>", cmd);
+    if (serialCallbackID >= 0 || readerThread.joinable())
+        return;
 
-    if (!isSimulation())
+    bool replaying = false;
+    if (isSimulation() && ReplayS[REPLAY_ENABLE].s == ISS_ON)
     {
-        tcflush(PortFD, TCIOFLUSH);
-        if ((tty_rc = tty_write_string(PortFD, cmd, &nbytes_written)) != TTY_OK)
+        replaying = replayer.start(ReplayFileT[0].text, ReplaySpeedN[0].value);
+        if (replaying)
         {
-            char errorMessage[MAXRBUF];
-            tty_error_msg(tty_rc, errorMessage, MAXRBUF);
-            LOGF_ERROR("Serial write error: %s", errorMessage);
-            return false;
+            ingestSource = SOURCE_REPLAY;
+            ingestFD = replayer.fd();
+            if (ReplaySpeedN[0].value > 0)
+                LOGF_INFO("Replaying %s at %.1fx.", ReplayFileT[0].text, ReplaySpeedN[0].value);
+            else
+                LOGF_INFO("Replaying %s at maximum speed.", ReplayFileT[0].text);
+        }
+        else
+        {
+            LOGF_ERROR("Cannot replay %s: %s", ReplayFileT[0].text, strerror(errno));
+            IUResetSwitch(&ReplaySP);
+            ReplayS[REPLAY_DISABLE].s = ISS_ON;
+            ReplaySP.s = IPS_ALERT;
+            IDSetSwitch(&ReplaySP, nullptr);
         }
     }
 
-    if (isSimulation())
+    // Simulator and replay write into a pipe that is read exactly like the port
+    if (replaying)
     {
-        strncpy(res, "OK#", 8);
-        nbytes_read = 3;
+        // Source already set up above
     }
-    else
+    else if (isSimulation())
     {
-        if ((tty_rc = tty_read_section(PortFD, res, '#', 1, &nbytes_read)) != TTY_OK)
+        applySimulatorSettings();
+        if (!simulator.start())
         {
-            char errorMessage[MAXRBUF];
-            tty_error_msg(tty_rc, errorMessage, MAXRBUF);
-            LOGF_ERROR("Serial read error: %s", errorMessage);
-            // Don't print error for timeout - normal for continuous reading
-            return false;
+            LOGF_ERROR("Failed to start simulator: %s", strerror(errno));
+            return;
         }
+        ingestSource = SOURCE_SIMULATOR;
+        ingestFD = simulator.fd();
+        simulatorOverruns = 0;
     }
+    else
+    {
+        if (PortFD < 0)
+            return;
+        ingestSource = SOURCE_PORT;
+        ingestFD = PortFD;
 
-    res[nbytes_read - 1] = '\0';
-    LOGF_DEBUG("RES <%s>", res);
+        // Never block the INDI main loop (or the reader thread) in read()
+        int flags = fcntl(PortFD, F_GETFL, 0);
+        if (flags >= 0)
+            fcntl(PortFD, F_SETFL, flags | O_NONBLOCK);
+    }
 
-    return true;
-}
+    framer.reset();
+    framerTruncated = 0;
+    commands.setFD(ingestSource == SOURCE_PORT ? PortFD : -1);
 
-bool AMSKY01::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
-{
-    return INDI::Weather::ISNewSwitch(dev, name, states, names, n);
+    if (ReaderModeS[READER_THREAD].s == ISS_ON)
+    {
+        wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        stopFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFD >= 0 && stopFD >= 0)
+        {
+            sampleQueue.clear();
+            replyQueue.clear();
+            queueHighWater = 0;
+            queueOverflows = 0;
+            readerError = 0;
+            readerRunning = true;
+            queueCallbackID = IEAddCallback(wakeFD, queueReadyCallback, this);
+            readerThread = std::thread(&AMSKY01::readerLoop, this);
+            LOGF_DEBUG("Reader thread started on FD %d", ingestFD);
+            return;
+        }
+
+        LOGF_ERROR("Failed to create reader thread events: %s. Reading from main loop.", strerror(errno));
+        if (wakeFD >= 0)
+            close(wakeFD);
+        if (stopFD >= 0)
+            close(stopFD);
+        wakeFD = stopFD = -1;
+    }
+
+    serialCallbackID = IEAddCallback(ingestFD, serialReadCallback, this);
+    LOGF_DEBUG("Watching FD %d for incoming data", ingestFD);
 }
 
-void AMSKY01::TimerHit()
+void AMSKY01::stopIngest()
 {
-    if (isConnected())
+    if (serialCallbackID >= 0)
     {
-        readSerialData();
-        SetTimer(100); // Continue reading every 100ms
+        IERmCallback(serialCallbackID);
+        serialCallbackID = -1;
     }
-}
 
-bool AMSKY01::readSerialData()
-{
-    // Use PortFD from base Weather class
-    if (PortFD < 0)
+    if (readerThread.joinable())
     {
-        return false;
+        uint64_t one = 1;
+        readerRunning = false;
+        if (write(stopFD, &one, sizeof(one)) < 0)
+            LOGF_DEBUG("Reader stop signal failed: %s", strerror(errno));
+        readerThread.join();
     }
 
-    char buffer[1024] = {0};
-    int nbytes_read = 0;
-    
-    if (isSimulation())
+    if (frameTimerID >= 0)
     {
-        // Generate realistic AMSKY01 test data
-        static int counter = 0;
-        counter++;
-        
-        switch (counter % 3)
-        {
-            case 0:
-                // Hygro: temperature, humidity
-                snprintf(buffer, sizeof(buffer), "$hygro,%.2f,%.2f", 
-                        25.0 + (counter % 20), 45.0 + (counter % 30));
-                break;
-            case 1:
-                // Light: lux, raw1, raw2, gain, integration_time
-                snprintf(buffer, sizeof(buffer), "$light,%.2f,%d,%d,%d,%d", 
-                        1500.0 + (counter % 1000), 4500 + (counter % 500), 
-                        2100 + (counter % 200), 1, 300);
-                break;
-            case 2:
-                // Cloud: 5 sky temperatures (ADC values)
-                snprintf(buffer, sizeof(buffer), "$cloud,%.2f,%.2f,%.2f,%.2f,%.2f",
-                        65100.0 + (counter % 50), 65140.0 + (counter % 40), 
-                        65050.0 + (counter % 30), 65070.0 + (counter % 45),
-                        65100.0 + (counter % 35));
-                break;
-        }
-        
-        nbytes_read = strlen(buffer);
-        processData(std::string(buffer));
-        return true;
+        IERmTimer(frameTimerID);
+        frameTimerID = -1;
     }
 
-    LOGF_DEBUG("Reading serial data from FD %d", PortFD);
-    
-    // Try to read a line of data (ending with newline)
-    int tty_rc = tty_read_section(PortFD, buffer, '\n', 3, &nbytes_read);
-    
-    if (tty_rc == TTY_OK && nbytes_read > 0)
+    if (queueCallbackID >= 0)
     {
-        buffer[nbytes_read - 1] = '\0'; // Remove newline
-        std::string dataLine(buffer);
-        processData(dataLine);
-        return true;
+        IERmCallback(queueCallbackID);
+        queueCallbackID = -1;
     }
-    else if (tty_rc == TTY_TIME_OUT)
+    if (wakeFD >= 0)
     {
-        // Timeout is normal when no data is available
-        return true;
+        close(wakeFD);
+        wakeFD = -1;
     }
-    else if (tty_rc != TTY_OK)
+    if (stopFD >= 0)
     {
-        char errorMessage[MAXRBUF];
-        tty_error_msg(tty_rc, errorMessage, MAXRBUF);
-        LOGF_DEBUG("Serial read error: %s", errorMessage);
-        return false;
+        close(stopFD);
+        stopFD = -1;
     }
-    
-    return true;
+
+    // Replies still on the wire would be lost with the framer state
+    if (commandTimerID >= 0)
+    {
+        IERmTimer(commandTimerID);
+        commandTimerID = -1;
+    }
+    commands.cancel();
+    commands.setFD(-1);
+
+    simulator.stop();
+    replayer.stop();
+    ingestFD = -1;
+    ingestSource = SOURCE_PORT;
 }
 
-void AMSKY01::processData(const std::string& data)
+void AMSKY01::ingestEnded()
 {
-    if (data.empty())
+    bool replay = ingestSource == SOURCE_REPLAY;
+    stopIngest();
+
+    if (!replay)
+    {
+        LOG_ERROR("Serial port closed by device.");
         return;
-        
-    // Ignoruj řádky nezačínající $
-    if (data[0] != '$')
+    }
+
+    if (replayer.truncated())
+        LOGF_ERROR("Replay stopped after %llu bytes, the capture file is truncated.",
+                   static_cast<unsigned long long>(replayer.bytes()));
+    else if (replayer.failed())
+        LOGF_ERROR("Replay stopped after %llu bytes, the capture file is corrupt: %s",
+                   static_cast<unsigned long long>(replayer.bytes()), strerror(replayer.failed()));
+    else
+        LOGF_INFO("Replay finished after %llu bytes.", static_cast<unsigned long long>(replayer.bytes()));
+    IUResetSwitch(&ReplaySP);
+    ReplayS[REPLAY_DISABLE].s = ISS_ON;
+    ReplaySP.s = IPS_OK;
+    IDSetSwitch(&ReplaySP, nullptr);
+
+    // Back to the simulator
+    startIngest();
+}
+
+void AMSKY01::captureChunk(ssize_t nbytes, int64_t received)
+{
+    if (!capture.isOpen() || nbytes <= 0)
         return;
-        
-    
-    // Parse weather data
-    if (parseHygro(data) || parseLight(data) || parseCloud(data))
+
+    struct iovec iov[2];
+    int count = framer.recent(static_cast<size_t>(nbytes), iov);
+    capture.write(received, iov, count);
+}
+
+void AMSKY01::serialReadCallback(int fd, void *userpointer)
+{
+    INDI_UNUSED(fd);
+    static_cast<AMSKY01 *>(userpointer)->readSerialData();
+}
+
+void AMSKY01::queueReadyCallback(int fd, void *userpointer)
+{
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        return;
+
+    static_cast<AMSKY01 *>(userpointer)->drainQueue();
+}
+
+void AMSKY01::readerLoop()
+{
+    // Runs on the reader thread: no INDI calls here, errors are handed over
+    // through readerError and reported by drainQueue()
+    struct pollfd fds[2];
+    fds[0].fd = ingestFD;
+    fds[0].events = POLLIN;
+    fds[1].fd = stopFD;
+    fds[1].events = POLLIN;
+
+    while (readerRunning.load(std::memory_order_relaxed))
     {
-        weatherData.dataValid = (weatherData.hygroValid || weatherData.lightValid || weatherData.cloudValid);
-        
-        // Update weather parameters
-        if (weatherData.hygroValid)
+        if (poll(fds, 2, -1) < 0)
         {
-            setParameterValue("WEATHER_TEMPERATURE", weatherData.temperature);
-            setParameterValue("WEATHER_HUMIDITY", weatherData.humidity);
-            setParameterValue("WEATHER_DEW_POINT", weatherData.dewPoint);
+            if (errno == EINTR)
+                continue;
+            readerError = errno;
+            break;
         }
-        
-        if (weatherData.lightValid)
+
+        if (fds[1].revents)
+            break;
+
+        ssize_t nbytes_read = framer.readFrom(ingestFD);
+        if (nbytes_read < 0)
         {
-            setParameterValue("WEATHER_LIGHT_LUX", weatherData.lux);
-            setParameterValue("WEATHER_SKY_BRIGHTNESS", weatherData.skyBrightness);
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                continue;
+            readerError = errno;
+            break;
         }
-        
-        if (weatherData.cloudValid)
+        else if (nbytes_read == 0 && framer.space() > 0)
+        {
+            readerError = EPIPE;
+            break;
+        }
+
+        bool queued = false;
+        int64_t received = AMSKY01Protocol::monotonicNs();
+        captureChunk(nbytes_read, received);
+        framer.drain([this, &queued, received](const char *line, size_t length)
+        {
+            AMSKY01Protocol::Sentence sentence;
+            AMSKY01Protocol::ParseResult result = AMSKY01Protocol::parseSentence(line, length, sentence);
+            streamCounters.count(result, sentence.type);
+            if (result == AMSKY01Protocol::ParseResult::REPLY)
+            {
+                // Replies are rare and short, longer ones are cut to fit
+                Reply reply;
+                reply.length = std::min(length, sizeof(reply.text) - 1);
+                memcpy(reply.text, line, reply.length);
+                reply.text[reply.length] = '\0';
+                if (replyQueue.push(reply))
+                    queued = true;
+                return;
+            }
+            if (result != AMSKY01Protocol::ParseResult::OK)
+                return;
+
+            sentence.received = received;
+            sentence.parsed = AMSKY01Protocol::monotonicNs();
+            if (sampleQueue.push(sentence))
+                queued = true;
+            else
+                queueOverflows.fetch_add(1, std::memory_order_relaxed);
+        });
+        countRead(nbytes_read);
+
+        // One wakeup per batch, not per line
+        if (queued)
         {
-            setParameterValue("WEATHER_SKY_TEMPERATURE", weatherData.avgCloudTemp);
-            setParameterValue("WEATHER_CLOUD_COVER", weatherData.cloudCover);
-            
-            // Aktualizuj všechny individuální sky teploty
-            setParameterValue("WEATHER_SKY_TEMP_1", weatherData.cloudTemp[0]);
-            setParameterValue("WEATHER_SKY_TEMP_2", weatherData.cloudTemp[1]);
-            setParameterValue("WEATHER_SKY_TEMP_3", weatherData.cloudTemp[2]);
-            setParameterValue("WEATHER_SKY_TEMP_4", weatherData.cloudTemp[3]);
-            setParameterValue("WEATHER_SKY_TEMP_5", weatherData.cloudTemp[4]);
+            uint64_t one = 1;
+            if (write(wakeFD, &one, sizeof(one)) < 0 && errno != EAGAIN)
+                readerError = errno;
         }
     }
+
+    // Let the INDI thread notice that we are gone
+    uint64_t one = 1;
+    if (write(wakeFD, &one, sizeof(one)) < 0)
+        readerError = errno;
+}
+
+void AMSKY01::drainQueue()
+{
+    size_t depth = sampleQueue.size();
+    if (depth > queueHighWater)
+        queueHighWater = depth;
+
+    AMSKY01Protocol::Sentence sentence;
+    while (sampleQueue.pop(sentence))
+        applySentence(sentence);
+
+    Reply reply;
+    while (replyQueue.pop(reply))
+        commandReply(reply.text, reply.length);
+
+    int error = readerError.exchange(0);
+    if (error != 0 && readerRunning)
+    {
+        readerRunning = false;
+        if (error == EPIPE)
+            ingestEnded();
+        else
+            LOGF_ERROR("Serial read error: %s", strerror(error));
+    }
+}
+
+void AMSKY01::updateQueueStats()
+{
+    double depth = sampleQueue.size();
+    double highWater = queueHighWater;
+    double overflows = queueOverflows.load(std::memory_order_relaxed);
+
+    if (depth == ReaderQueueN[QUEUE_DEPTH].value && highWater == ReaderQueueN[QUEUE_HIGH_WATER].value &&
+            overflows == ReaderQueueN[QUEUE_OVERFLOWS].value)
+        return;
+
+    ReaderQueueN[QUEUE_DEPTH].value = depth;
+    ReaderQueueN[QUEUE_HIGH_WATER].value = highWater;
+    ReaderQueueN[QUEUE_OVERFLOWS].value = overflows;
+    ReaderQueueNP.s = overflows > 0 ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&ReaderQueueNP, nullptr);
+}
+
+bool AMSKY01::Handshake()
+{
+    if (isSimulation())
+    {
+        LOGF_INFO("Connected successfully to simulated %s.", getDeviceName());
+        return true;
+    }
+
+    // Weather base class handles connection management
+    // Just confirm connection is ready
+    LOGF_INFO("Connected successfully to %s.", getDeviceName());
     
-    // Log received data only in debug mode
-    if (isDebug())
-        LOGF_DEBUG("Received data: %s", data.c_str());
+    return true;
 }
 
-// Weather-specific functions
-IPState AMSKY01::updateWeather()
+void AMSKY01::sendCommand(const char *cmd, CommandQueue::Callback done, int timeoutMs)
 {
-    if (weatherData.dataValid)
-        return IPS_OK;
-    else
-        return IPS_BUSY;
+    LOGF_DEBUG("CMD <%s>", cmd);
+
+    std::string command(cmd);
+    commands.submit(command, timeoutMs, [this, command, done](bool ok, const std::string &reply)
+    {
+        // Pending commands are cancelled on every disconnect, not worth a warning
+        if (!ok && reply != "cancelled")
+            LOGF_WARN("Command %s failed: %s", command.c_str(), reply.c_str());
+        if (done)
+            done(ok, reply);
+    });
+    pumpCommands();
+}
+
+void AMSKY01::pumpCommands()
+{
+    // Without a port (simulation, replay) commands are answered in place
+    int64_t deadline = commands.pump(AMSKY01Protocol::monotonicNs());
+    if (deadline != 0)
+        armCommandTimer(deadline);
+}
+
+void AMSKY01::armCommandTimer(int64_t deadline)
+{
+    if (commandTimerID >= 0)
+        return;
+
+    // Round up, a timer firing before the deadline would expire nothing
+    int64_t remaining = deadline - AMSKY01Protocol::monotonicNs();
+    commandTimerID = IEAddTimer(std::max<int>(1, static_cast<int>((remaining + 999999) / 1000000)),
+                                commandTimeoutCallback, this);
 }
 
-bool AMSKY01::parseHygro(const std::string& data)
+void AMSKY01::commandReply(const char *line, size_t length)
 {
-    // Parse: $hygro,temperature,humidity
-    if (data.find("$hygro,") == 0)
+    LOGF_DEBUG("RES <%.*s>", static_cast<int>(length), line);
+
+    if (commandTimerID >= 0)
     {
-        std::vector<std::string> tokens;
-        std::stringstream ss(data);
-        std::string token;
-        
-        while (std::getline(ss, token, ','))
-        {
-            tokens.push_back(token);
-        }
-        
-        if (tokens.size() >= 3)
-        {
-            try
-            {
-                weatherData.temperature = std::stod(tokens[1]);
-                weatherData.humidity = std::stod(tokens[2]);
-                
-                // Calculate dew point using Magnus formula
-                double a = 17.27;
-                double b = 237.7;
-                double alpha = ((a * weatherData.temperature) / (b + weatherData.temperature)) + log(weatherData.humidity / 100.0);
-                weatherData.dewPoint = (b * alpha) / (a - alpha);
-                
-                weatherData.hygroValid = true;
-                return true;
-            }
-            catch (const std::exception& e)
-            {
-                LOGF_ERROR("Error parsing hygro data: %s", e.what());
-            }
-        }
+        IERmTimer(commandTimerID);
+        commandTimerID = -1;
     }
-    return false;
+
+    if (!commands.reply(line, length))
+        LOGF_DEBUG("Unsolicited reply <%.*s>", static_cast<int>(length), line);
+
+    pumpCommands();
 }
 
-bool AMSKY01::parseLight(const std::string& data)
+void AMSKY01::commandTimeoutCallback(void *userpointer)
 {
-    // Parse: $light,lux,raw1,raw2,gain,integration_time_ms
-    if (data.find("$light,") == 0)
+    AMSKY01 *device = static_cast<AMSKY01 *>(userpointer);
+    device->commandTimerID = -1;
+
+    // Early by clock granularity: wait for the rest of the deadline
+    int64_t deadline = device->commands.expire(AMSKY01Protocol::monotonicNs());
+    if (deadline != 0)
     {
-        std::vector<std::string> tokens;
-        std::stringstream ss(data);
-        std::string token;
-        
-        while (std::getline(ss, token, ','))
-        {
-            tokens.push_back(token);
-        }
-        
-        if (tokens.size() >= 6)
-        {
-            try
-            {
-                weatherData.lux = std::stod(tokens[1]);
-                weatherData.raw1 = std::stoi(tokens[2]);
-                weatherData.raw2 = std::stoi(tokens[3]);
-                weatherData.gain = std::stoi(tokens[4]);
-                weatherData.integrationTime = std::stoi(tokens[5]);
-                
-                // Convert lux to sky brightness (lepší aproximace)
-                // Velmi tmavá obloha: ~22 mag/arcsec² při <0.01 lux
-                // Jasná obloha při úplňku: ~19 mag/arcsec² při ~0.1 lux  
-                // Městské světlo: ~16-18 mag/arcsec² při >10 lux
-
-                weatherData.lux = (static_cast<float>(weatherData.raw1) / static_cast<float>(weatherData.gain)) / static_cast<float>(weatherData.integrationTime);
-                weatherData.lux *= 1000000.0;
-
-                if (weatherData.lux < 0.001)
-                    weatherData.skyBrightness = 22.0;
-                else
-                    weatherData.skyBrightness = 22.0 - 2.5 * log10(weatherData.lux * 100);
-                
-                // Omez na rozumné hodnoty
-                if (weatherData.skyBrightness < 15.0) weatherData.skyBrightness = 15.0;
-                if (weatherData.skyBrightness > 22.5) weatherData.skyBrightness = 22.5;
-                
-                weatherData.lightValid = true;
-                return true;
-            }
-            catch (const std::exception& e)
-            {
-                LOGF_ERROR("Error parsing light data: %s", e.what());
-            }
-        }
+        device->armCommandTimer(deadline);
+        return;
     }
-    return false;
+    device->pumpCommands();
 }
 
-bool AMSKY01::parseCloud(const std::string& data)
+bool AMSKY01::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
 {
-    // Parse: $cloud,temp1,temp2,temp3,temp4,temp5 (4 segmenty + zenit)
-    if (data.find("$cloud,") == 0)
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
     {
-        std::vector<std::string> tokens;
-        std::stringstream ss(data);
-        std::string token;
-        
-        while (std::getline(ss, token, ','))
+        // Serial reader mode, restart ingestion when connected
+        if (strcmp(name, ReaderModeSP.name) == 0)
         {
-            tokens.push_back(token);
+            IUUpdateSwitch(&ReaderModeSP, states, names, n);
+            ReaderModeSP.s = IPS_OK;
+            IDSetSwitch(&ReaderModeSP, nullptr);
+
+            if (isConnected())
+            {
+                stopIngest();
+                startIngest();
+            }
+
+            LOGF_INFO("Serial data is read %s",
+                      ReaderModeS[READER_THREAD].s == ISS_ON ? "by a dedicated reader thread" : "from the main loop");
+            return true;
         }
-        
-        if (tokens.size() >= 6)
+
+        // Raw capture, opened and closed with ingestion paused so the reading
+        // thread never sees the file change under it
+        if (strcmp(name, CaptureSP.name) == 0)
         {
-            try
+            IUUpdateSwitch(&CaptureSP, states, names, n);
+            bool enable = CaptureS[CAPTURE_ENABLE].s == ISS_ON;
+            bool running = serialCallbackID >= 0 || readerThread.joinable();
+            if (running)
+                stopIngest();
+
+            CaptureSP.s = IPS_OK;
+            if (enable)
             {
-                // Načti 5 teplot oblohy
-                double tempSum = 0.0;
-                for (int i = 0; i < 5; i++)
+                if (CaptureFileT[0].text == nullptr || CaptureFileT[0].text[0] == '\0')
                 {
-                    weatherData.cloudTemp[i] = std::stod(tokens[i + 1]);
-                    tempSum += weatherData.cloudTemp[i];
+                    char path[MAXINDINAME * 4];
+                    char stamp[32];
+                    time_t now = time(nullptr);
+                    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", gmtime(&now));
+                    const char *home = getenv("HOME");
+                    snprintf(path, sizeof(path), "%s/amsky01_%s.cap", home ? home : "/tmp", stamp);
+                    IUSaveText(&CaptureFileT[0], path);
+                    IDSetText(&CaptureFileTP, nullptr);
                 }
-                
-                weatherData.avgCloudTemp = tempSum / 5.0;
-                
-                double minSkyTemp = 64000.0;  // jasná studená obloha
-                double maxSkyTemp = 66000.0;  // velmi oblačno
-                
-                weatherData.cloudCover = ((weatherData.avgCloudTemp - minSkyTemp) / (maxSkyTemp - minSkyTemp)) * 100.0;
-                if (weatherData.cloudCover < 0.0) weatherData.cloudCover = 0.0;
-                if (weatherData.cloudCover > 100.0) weatherData.cloudCover = 100.0;
-                
-                weatherData.cloudValid = true;
+
+                if (capture.open(CaptureFileT[0].text))
+                    LOGF_INFO("Recording raw stream to %s.", CaptureFileT[0].text);
+                else
+                {
+                    LOGF_ERROR("Cannot record to %s: %s", CaptureFileT[0].text, strerror(errno));
+                    IUResetSwitch(&CaptureSP);
+                    CaptureS[CAPTURE_DISABLE].s = ISS_ON;
+                    CaptureSP.s = IPS_ALERT;
+                }
+            }
+            else if (capture.isOpen())
+            {
+                uint64_t bytes = capture.bytes();
+                capture.close();
+                LOGF_INFO("Raw capture stopped after %llu bytes.", static_cast<unsigned long long>(bytes));
+            }
+
+            if (running)
+                startIngest();
+            IDSetSwitch(&CaptureSP, nullptr);
+            return true;
+        }
+
+        // Shared-memory snapshot
+        if (strcmp(name, SharedSnapshotSP.name) == 0)
+        {
+            IUUpdateSwitch(&SharedSnapshotSP, states, names, n);
+            SharedSnapshotSP.s = IPS_OK;
+
+            closeSharedSnapshot();
+            if (SharedSnapshotS[SHARED_ENABLE].s == ISS_ON && isConnected() && !openSharedSnapshot())
+            {
+                IUResetSwitch(&SharedSnapshotSP);
+                SharedSnapshotS[SHARED_DISABLE].s = ISS_ON;
+                SharedSnapshotSP.s = IPS_ALERT;
+            }
+
+            IDSetSwitch(&SharedSnapshotSP, nullptr);
+            return true;
+        }
+
+        // Local JSON feed
+        if (strcmp(name, FeedSP.name) == 0)
+        {
+            IUUpdateSwitch(&FeedSP, states, names, n);
+            FeedSP.s = IPS_OK;
+
+            stopFeed();
+            if (FeedS[FEED_ENABLE].s == ISS_ON && isConnected() && !startFeed())
+            {
+                IUResetSwitch(&FeedSP);
+                FeedS[FEED_DISABLE].s = ISS_ON;
+                FeedSP.s = IPS_ALERT;
+            }
+
+            IDSetSwitch(&FeedSP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, ArchiveSP.name) == 0)
+        {
+            IUUpdateSwitch(&ArchiveSP, states, names, n);
+            ArchiveSP.s = IPS_OK;
+
+            archive.close();
+            if (ArchiveS[ARCHIVE_ENABLE].s == ISS_ON && isConnected() && !startArchive())
+            {
+                IUResetSwitch(&ArchiveSP);
+                ArchiveS[ARCHIVE_DISABLE].s = ISS_ON;
+                ArchiveSP.s = IPS_ALERT;
+            }
+
+            IDSetSwitch(&ArchiveSP, nullptr);
+            return true;
+        }
+
+        // Replay replaces the simulator until the recording ends
+        if (strcmp(name, ReplaySP.name) == 0)
+        {
+            IUUpdateSwitch(&ReplaySP, states, names, n);
+            ReplaySP.s = IPS_OK;
+            IDSetSwitch(&ReplaySP, nullptr);
+            if (isConnected())
+            {
+                stopIngest();
+                startIngest();
+            }
+            return true;
+        }
+
+        // Night quantiles restart now instead of at the next sunset
+        if (strcmp(name, NightResetSP.name) == 0)
+        {
+            resetNightQuantiles();
+            IUResetSwitch(&NightResetSP);
+            NightResetSP.s = IPS_OK;
+            IDSetSwitch(&NightResetSP, nullptr);
+            LOG_INFO("Night quantiles reset.");
+            return true;
+        }
+
+        if (strcmp(name, HistoryExportSP.name) == 0)
+        {
+            IUUpdateSwitch(&HistoryExportSP, states, names, n);
+            int tier = IUFindOnSwitchIndex(&HistoryExportSP);
+            IUResetSwitch(&HistoryExportSP);
+            HistoryExportSP.s = (tier >= 0 && sendHistory(tier)) ? IPS_OK : IPS_ALERT;
+            IDSetSwitch(&HistoryExportSP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, HistoryCompressSP.name) == 0)
+        {
+            IUUpdateSwitch(&HistoryCompressSP, states, names, n);
+            HistoryCompressSP.s = IPS_OK;
+            IDSetSwitch(&HistoryCompressSP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, WarmStartSP.name) == 0)
+        {
+            IUUpdateSwitch(&WarmStartSP, states, names, n);
+            WarmStartSP.s = IPS_OK;
+            IDSetSwitch(&WarmStartSP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, CloudOnsetSafetySP.name) == 0)
+        {
+            IUUpdateSwitch(&CloudOnsetSafetySP, states, names, n);
+            CloudOnsetSafetySP.s = IPS_OK;
+            IDSetSwitch(&CloudOnsetSafetySP, nullptr);
+            evaluateSafety();
+            return true;
+        }
+
+        // Simulator scenario, applies immediately
+        if (strcmp(name, SimScenarioSP.name) == 0)
+        {
+            IUUpdateSwitch(&SimScenarioSP, states, names, n);
+            applySimulatorSettings();
+            SimScenarioSP.s = IPS_OK;
+            IDSetSwitch(&SimScenarioSP, nullptr);
+            LOGF_INFO("Simulating scenario %s.", IUFindOnSwitch(&SimScenarioSP)->label);
+            return true;
+        }
+
+        // Latency histograms reset
+        if (strcmp(name, LatencyResetSP.name) == 0)
+        {
+            for (size_t i = 0; i < STAGE_COUNT; i++)
+                latency[i].reset();
+            latencyReported = 0;
+
+            LatencyNP.s = IPS_IDLE;
+            updateLatencyStats();
+
+            LatencyResetS[0].s = ISS_OFF;
+            LatencyResetSP.s = IPS_OK;
+            IDSetSwitch(&LatencyResetSP, nullptr);
+            LOG_INFO("Latency statistics reset.");
+            return true;
+        }
+    }
+
+    return INDI::Weather::ISNewSwitch(dev, name, states, names, n);
+}
+
+bool AMSKY01::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
+{
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
+    {
+        // Frame deadline, applies from the next frame
+        if (strcmp(name, FrameDeadlineNP.name) == 0)
+        {
+            IUUpdateNumber(&FrameDeadlineNP, values, names, n);
+            FrameDeadlineNP.s = IPS_OK;
+            IDSetNumber(&FrameDeadlineNP, nullptr);
+            return true;
+        }
+
+        // Replay speed, applies to the next replay
+        if (strcmp(name, ReplaySpeedNP.name) == 0)
+        {
+            IUUpdateNumber(&ReplaySpeedNP, values, names, n);
+            ReplaySpeedNP.s = IPS_OK;
+            IDSetNumber(&ReplaySpeedNP, nullptr);
+            return true;
+        }
+
+        // Statistics windows, restart from the next sample
+        if (strcmp(name, StatsWindowsNP.name) == 0)
+        {
+            IUUpdateNumber(&StatsWindowsNP, values, names, n);
+            applyStatsWindows();
+            StatsWindowsNP.s = IPS_OK;
+            IDSetNumber(&StatsWindowsNP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, WarmStartNP.name) == 0)
+        {
+            IUUpdateNumber(&WarmStartNP, values, names, n);
+            WarmStartNP.s = IPS_OK;
+            IDSetNumber(&WarmStartNP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, CloudOnsetNP.name) == 0)
+        {
+            IUUpdateNumber(&CloudOnsetNP, values, names, n);
+            applyCloudOnsetSettings();
+            CloudOnsetNP.s = IPS_OK;
+            IDSetNumber(&CloudOnsetNP, nullptr);
+            return true;
+        }
+
+        // Simulator line rate and scenario period
+        if (strcmp(name, SimSettingsNP.name) == 0)
+        {
+            IUUpdateNumber(&SimSettingsNP, values, names, n);
+            applySimulatorSettings();
+            SimSettingsNP.s = IPS_OK;
+            IDSetNumber(&SimSettingsNP, nullptr);
+            return true;
+        }
+
+        // Sensor staleness limits, checked at the next housekeeping run
+        if (strcmp(name, SensorTimeoutNP.name) == 0)
+        {
+            IUUpdateNumber(&SensorTimeoutNP, values, names, n);
+            SensorTimeoutNP.s = IPS_OK;
+            IDSetNumber(&SensorTimeoutNP, nullptr);
+            return true;
+        }
+
+        // Publication filter
+        if (strcmp(name, DeadbandAbsNP.name) == 0 || strcmp(name, DeadbandRelNP.name) == 0 ||
+                strcmp(name, MaxSilenceNP.name) == 0)
+        {
+            INumberVectorProperty *nvp = (strcmp(name, DeadbandAbsNP.name) == 0) ? &DeadbandAbsNP :
+                                         (strcmp(name, DeadbandRelNP.name) == 0) ? &DeadbandRelNP : &MaxSilenceNP;
+            IUUpdateNumber(nvp, values, names, n);
+            applyPublishFilterSettings();
+            nvp->s = IPS_OK;
+            IDSetNumber(nvp, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::Weather::ISNewNumber(dev, name, values, names, n);
+}
+
+bool AMSKY01::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
+    {
+        // Capture and replay files, segment name, feed socket, archive
+        // directory and warm start file, used the next time they are enabled
+        if (strcmp(name, CaptureFileTP.name) == 0 || strcmp(name, ReplayFileTP.name) == 0 ||
+                strcmp(name, SharedNameTP.name) == 0 || strcmp(name, FeedPathTP.name) == 0 ||
+                strcmp(name, ArchiveDirTP.name) == 0 || strcmp(name, WarmStartFileTP.name) == 0)
+        {
+            ITextVectorProperty *tvp = (strcmp(name, CaptureFileTP.name) == 0) ? &CaptureFileTP :
+                                       (strcmp(name, ReplayFileTP.name) == 0) ? &ReplayFileTP :
+                                       (strcmp(name, SharedNameTP.name) == 0) ? &SharedNameTP :
+                                       (strcmp(name, FeedPathTP.name) == 0) ? &FeedPathTP :
+                                       (strcmp(name, ArchiveDirTP.name) == 0) ? &ArchiveDirTP : &WarmStartFileTP;
+            IUUpdateText(tvp, texts, names, n);
+            tvp->s = IPS_OK;
+            IDSetText(tvp, nullptr);
+            return true;
+        }
+
+        // Firmware command, the reply comes back through the framer
+        if (strcmp(name, DeviceCommandTP.name) == 0)
+        {
+            IUUpdateText(&DeviceCommandTP, texts, names, n);
+            if (DeviceCommandT[0].text[0] == '\0')
+            {
+                DeviceCommandTP.s = IPS_ALERT;
+                IDSetText(&DeviceCommandTP, nullptr);
                 return true;
             }
-            catch (const std::exception& e)
+
+            DeviceCommandTP.s = IPS_BUSY;
+            IDSetText(&DeviceCommandTP, nullptr);
+            sendCommand(DeviceCommandT[0].text, [this](bool ok, const std::string &reply)
+            {
+                // Disconnected, the properties are gone
+                if (!ok && reply == "cancelled")
+                    return;
+
+                IUSaveText(&DeviceReplyT[0], reply.c_str());
+                DeviceReplyTP.s = ok ? IPS_OK : IPS_ALERT;
+                IDSetText(&DeviceReplyTP, nullptr);
+                DeviceCommandTP.s = DeviceReplyTP.s;
+                IDSetText(&DeviceCommandTP, nullptr);
+            });
+            return true;
+        }
+    }
+
+    return INDI::Weather::ISNewText(dev, name, texts, names, n);
+}
+
+bool AMSKY01::saveConfigItems(FILE *fp)
+{
+    INDI::Weather::saveConfigItems(fp);
+
+    IUSaveConfigNumber(fp, &FrameDeadlineNP);
+    IUSaveConfigNumber(fp, &DeadbandAbsNP);
+    IUSaveConfigNumber(fp, &DeadbandRelNP);
+    IUSaveConfigNumber(fp, &MaxSilenceNP);
+    IUSaveConfigNumber(fp, &SensorTimeoutNP);
+    IUSaveConfigSwitch(fp, &ReaderModeSP);
+    IUSaveConfigNumber(fp, &StatsWindowsNP);
+    IUSaveConfigSwitch(fp, &HistoryCompressSP);
+    IUSaveConfigNumber(fp, &CloudOnsetNP);
+    IUSaveConfigSwitch(fp, &CloudOnsetSafetySP);
+    IUSaveConfigSwitch(fp, &SimScenarioSP);
+    IUSaveConfigNumber(fp, &SimSettingsNP);
+    IUSaveConfigSwitch(fp, &SharedSnapshotSP);
+    IUSaveConfigText(fp, &SharedNameTP);
+    IUSaveConfigSwitch(fp, &FeedSP);
+    IUSaveConfigText(fp, &FeedPathTP);
+    IUSaveConfigText(fp, &CaptureFileTP);
+    IUSaveConfigSwitch(fp, &ArchiveSP);
+    IUSaveConfigText(fp, &ArchiveDirTP);
+    IUSaveConfigSwitch(fp, &WarmStartSP);
+    IUSaveConfigText(fp, &WarmStartFileTP);
+    IUSaveConfigNumber(fp, &WarmStartNP);
+    IUSaveConfigText(fp, &ReplayFileTP);
+    IUSaveConfigNumber(fp, &ReplaySpeedNP);
+
+    return true;
+}
+
+void AMSKY01::TimerHit()
+{
+    if (!isConnected())
+        return;
+
+    // Data is serviced by serialReadCallback or the reader thread, for the
+    // simulator as well
+    int64_t now = AMSKY01Protocol::monotonicNs();
+    if (now - lastHousekeeping >= static_cast<int64_t>(getCurrentPollingPeriod()) * 1000000)
+    {
+        lastHousekeeping = now;
+        housekeeping();
+    }
+
+    SetTimer(getCurrentPollingPeriod());
+}
+
+void AMSKY01::housekeeping()
+{
+    int64_t now = AMSKY01Protocol::monotonicNs();
+
+    if (readerThread.joinable())
+        updateQueueStats();
+
+    int captureError = capture.failed();
+    if (captureError != 0 && CaptureS[CAPTURE_ENABLE].s == ISS_ON)
+    {
+        LOGF_ERROR("Raw capture stopped: %s", strerror(captureError));
+        IUResetSwitch(&CaptureSP);
+        CaptureS[CAPTURE_DISABLE].s = ISS_ON;
+        CaptureSP.s = IPS_ALERT;
+        IDSetSwitch(&CaptureSP, nullptr);
+    }
+
+    if (feed.listenFD() >= 0)
+    {
+        feed.flush();
+        updateFeedStatus();
+    }
+
+    uint64_t overruns = simulator.overruns();
+    if (overruns > simulatorOverruns)
+    {
+        LOGF_WARN("Simulator lost %llu lines, ingest is not keeping up.",
+                  static_cast<unsigned long long>(overruns - simulatorOverruns));
+        simulatorOverruns = overruns;
+    }
+
+    checkFreshness(now);
+    updateSensorTiming(now);
+    updateLatencyStats();
+    updateStreamHealth(now);
+    updateWindowStats(now);
+    trackSun();
+    updateNightQuantiles();
+    updateHistorySpan();
+    updateCloudOnsetScores();
+    if (warmDirty && WarmStartS[WARM_START_ENABLE].s == ISS_ON &&
+            now - lastWarmSave >= static_cast<int64_t>(WarmStartN[WARM_INTERVAL].value * 1e9))
+        storeWarmState();
+    if (archive.isOpen())
+        updateArchiveStatus();
+}
+
+bool AMSKY01::startArchive()
+{
+    std::vector<std::string> names;
+    for (const AMSKY01Protocol::ParameterSpec &spec : AMSKY01Protocol::PARAMETERS)
+        names.push_back(spec.name);
+
+    if (!archive.open(ArchiveDirT[0].text, "amsky01", names, ARCHIVE_ROWS_PER_DAY))
+    {
+        LOGF_ERROR("Cannot archive into %s: %s", ArchiveDirT[0].text, strerror(errno));
+        return false;
+    }
+
+    archiveError = 0;
+    LOGF_INFO("Archiving frames into %s.", ArchiveDirT[0].text);
+    return true;
+}
+
+void AMSKY01::updateArchiveStatus()
+{
+    // Segment errors are retried daily, report each new one once
+    int error = archive.failed();
+    if (error != archiveError)
+    {
+        if (error != 0)
+            LOGF_ERROR("Archive segment in %s unusable: %s", ArchiveDirT[0].text, strerror(error));
+        archiveError = error;
+    }
+
+    double rows = archive.rows();
+    double dropped = archive.dropped();
+    if (rows == ArchiveStatusN[ARCHIVE_ROWS].value && dropped == ArchiveStatusN[ARCHIVE_DROPPED].value)
+        return;
+
+    ArchiveStatusN[ARCHIVE_ROWS].value = rows;
+    ArchiveStatusN[ARCHIVE_DROPPED].value = dropped;
+    ArchiveStatusNP.s = (error != 0 || dropped > 0) ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&ArchiveStatusNP, nullptr);
+}
+
+void AMSKY01::updateHistorySpan()
+{
+    bool changed = false;
+    for (size_t t = 0; t < RollupHistory::TIER_COUNT; t++)
+    {
+        double hours = 0;
+        if (history.newest(t) >= 0)
+            hours = (history.newest(t) - history.oldest(t) + 1) * RollupHistory::TIERS[t].width / 3600.0;
+        if (hours != HistorySpanN[t].value)
+        {
+            HistorySpanN[t].value = hours;
+            changed = true;
+        }
+    }
+
+    if (!changed)
+        return;
+
+    HistorySpanNP.s = IPS_OK;
+    IDSetNumber(&HistorySpanNP, nullptr);
+}
+
+bool AMSKY01::sendHistory(size_t tier)
+{
+    bool compress = HistoryCompressS[HISTORY_COMPRESS_ON].s == ISS_ON;
+    size_t size = history.pack(tier, compress, historyBlob);
+    if (size == 0)
+    {
+        LOGF_WARN("No %s history to export.", RollupHistory::TIERS[tier].name);
+        HistoryBP.s = IPS_ALERT;
+        IDSetBLOB(&HistoryBP, nullptr);
+        return false;
+    }
+
+    // Size is the uncompressed length, the .z suffix tells clients to inflate
+    HistoryB[0].blob = historyBlob.data();
+    HistoryB[0].bloblen = static_cast<int>(historyBlob.size());
+    HistoryB[0].size = static_cast<int>(size);
+    strncpy(HistoryB[0].format, compress ? ".amsh.z" : ".amsh", sizeof(HistoryB[0].format) - 1);
+    HistoryBP.s = IPS_OK;
+    IDSetBLOB(&HistoryBP, nullptr);
+
+    LOGF_INFO("Exported %.1f h of %s history, %zu bytes.",
+              (history.newest(tier) - history.oldest(tier) + 1) * RollupHistory::TIERS[tier].width / 3600.0,
+              RollupHistory::TIERS[tier].name, historyBlob.size());
+    return true;
+}
+
+bool AMSKY01::updateLocation(double latitude, double longitude, double elevation)
+{
+    INDI_UNUSED(elevation);
+    siteLatitude = latitude;
+    siteLongitude = longitude;
+    siteKnown = true;
+    sunAltitude = NAN;
+    return true;
+}
+
+void AMSKY01::trackSun()
+{
+    if (!siteKnown)
+        return;
+
+    double now = static_cast<double>(time(nullptr));
+    double altitude = solarAltitude(now, siteLatitude, siteLongitude);
+
+    // Quantiles restored from a warm start belong to a past night if the Sun
+    // set while the driver was down; checked once the site is known
+    if (nightRestored != 0)
+    {
+        bool sunset = false;
+        double previous = solarAltitude(nightRestored / 1e9, siteLatitude, siteLongitude);
+        for (double t = nightRestored / 1e9 + 600; !sunset && t < now + 600; t += 600)
+        {
+            double current = solarAltitude(std::min(t, now), siteLatitude, siteLongitude);
+            sunset = previous > SUNSET_ALTITUDE && current <= SUNSET_ALTITUDE;
+            previous = current;
+        }
+        nightRestored = 0;
+        if (sunset)
+        {
+            LOG_INFO("The Sun set since the night quantiles were saved, restarted.");
+            resetNightQuantiles();
+        }
+    }
+
+    if (std::isfinite(sunAltitude) && sunAltitude > SUNSET_ALTITUDE && altitude <= SUNSET_ALTITUDE)
+    {
+        LOG_INFO("Sunset, night quantiles restarted.");
+        resetNightQuantiles();
+    }
+    sunAltitude = altitude;
+    sunUp = altitude > SUNSET_ALTITUDE;
+}
+
+void AMSKY01::resetNightQuantiles()
+{
+    for (auto &parameterQuantiles : nightQuantiles)
+        for (P2Quantile &quantile : parameterQuantiles)
+            quantile.reset();
+    nightStart = 0;
+    nightRestored = 0;
+    nightSamplesReported = static_cast<size_t>(-1);
+    updateNightQuantiles();
+}
+
+void AMSKY01::updateNightQuantiles()
+{
+    size_t samples = nightQuantiles[NIGHT_SKY_BRIGHTNESS][NIGHT_P50].count() +
+                     nightQuantiles[NIGHT_CLOUD_COVER][NIGHT_P50].count();
+    if (samples == nightSamplesReported)
+        return;
+    nightSamplesReported = samples;
+
+    for (size_t p = 0; p < NIGHT_PARAMETER_COUNT; p++)
+        for (size_t q = 0; q < NIGHT_QUANTILE_COUNT; q++)
+            NightQuantilesN[p * NIGHT_QUANTILE_COUNT + q].value = nightQuantiles[p][q].value();
+    NightQuantilesN[NIGHT_PARAMETER_COUNT * NIGHT_QUANTILE_COUNT].value = samples;
+    NightQuantilesNP.s = samples > 0 ? IPS_OK : IPS_IDLE;
+    IDSetNumber(&NightQuantilesNP, nullptr);
+}
+
+void AMSKY01::applyStatsWindows()
+{
+    for (auto &parameterStats : windowStats)
+        for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+            parameterStats[w].setWindow(StatsWindowsN[w].value * 60);
+}
+
+void AMSKY01::updateWindowStats(int64_t now)
+{
+    double seconds = now / 1e9;
+    for (size_t p = 0; p < STATS_PARAMETER_COUNT; p++)
+    {
+        bool changed = false;
+        for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+        {
+            WindowStats &stats = windowStats[p][w];
+            stats.expire(seconds);
+
+            const double values[STATS_PER_WINDOW] = { stats.min(), stats.max(), stats.mean(), stats.stddev() };
+            INumber *elements = &StatsN[p][w * STATS_PER_WINDOW];
+            for (size_t j = 0; j < STATS_PER_WINDOW; j++)
             {
-                LOGF_ERROR("Error parsing cloud data: %s", e.what());
+                if (elements[j].value != values[j])
+                {
+                    elements[j].value = values[j];
+                    changed = true;
+                }
             }
         }
+
+        if (!changed)
+            continue;
+
+        StatsNP[p].s = windowStats[p][0].count() > 0 ? IPS_OK : IPS_IDLE;
+        IDSetNumber(&StatsNP[p], nullptr);
     }
-    return false;
+}
+
+void AMSKY01::updateStreamHealth(int64_t now)
+{
+    double elapsed = lastHealthUpdate ? (now - lastHealthUpdate) / 1e9 : 0;
+    lastHealthUpdate = now;
+
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+    {
+        uint64_t parsed = streamCounters.parsed[i].load(std::memory_order_relaxed);
+        INumber *health = &StreamHealthN[i * HEALTH_PER_SENTENCE];
+        health[HEALTH_PARSED].value = parsed;
+        health[HEALTH_MALFORMED].value = streamCounters.malformed[i].load(std::memory_order_relaxed);
+        health[HEALTH_RATE].value = elapsed > 0 ? (parsed - healthParsed[i]) / elapsed : 0;
+        healthParsed[i] = parsed;
+    }
+
+    INumber *streamWide = &StreamHealthN[AMSKY01Protocol::SENTENCE_COUNT * HEALTH_PER_SENTENCE];
+    streamWide[HEALTH_UNKNOWN_TAG].value = streamCounters.unknownTag.load(std::memory_order_relaxed);
+    streamWide[HEALTH_NOT_SENTENCE].value = streamCounters.notSentence.load(std::memory_order_relaxed);
+    streamWide[HEALTH_TRUNCATED].value = streamCounters.truncated.load(std::memory_order_relaxed);
+    streamWide[HEALTH_BYTES_READ].value = streamCounters.bytesRead.load(std::memory_order_relaxed);
+    streamWide[HEALTH_REPLIES].value = streamCounters.replies.load(std::memory_order_relaxed);
+
+    // Busy once any line has been lost to truncation or a parse error
+    bool lost = streamWide[HEALTH_TRUNCATED].value > 0;
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+        lost |= StreamHealthN[i * HEALTH_PER_SENTENCE + HEALTH_MALFORMED].value > 0;
+
+    StreamHealthNP.s = lost ? IPS_BUSY : IPS_OK;
+    IDSetNumber(&StreamHealthNP, nullptr);
+}
+
+void AMSKY01::restoreWarmState()
+{
+    AMSKY01Protocol::WarmState state;
+    if (!AMSKY01Protocol::loadWarmState(WarmStartFileT[0].text, state))
+    {
+        if (errno != ENOENT)
+            LOGF_WARN("Cannot restore the last weather from %s: %s", WarmStartFileT[0].text, strerror(errno));
+        return;
+    }
+
+    int64_t wallClock = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    int64_t maxAge = static_cast<int64_t>(WarmStartN[WARM_MAX_AGE].value * 60 * 1e9);
+    int64_t now = AMSKY01Protocol::monotonicNs();
+    size_t restored = 0;
+    double oldest = 0;
+
+    // A night is never longer than a day; a sunset in between is caught by trackSun()
+    if (state.nightStart != 0 && wallClock - state.nightStart < 24 * 3600 * INT64_C(1000000000) &&
+            state.saved <= wallClock)
+    {
+        bool valid = true;
+        for (size_t p = 0; p < NIGHT_PARAMETER_COUNT; p++)
+            for (size_t q = 0; q < NIGHT_QUANTILE_COUNT; q++)
+                valid &= nightQuantiles[p][q].restore(state.night[p * NIGHT_QUANTILE_COUNT + q]);
+
+        if (valid)
+        {
+            nightSamplesReported = static_cast<size_t>(-1);
+            updateNightQuantiles();
+            nightStart = state.nightStart;
+            nightRestored = state.saved;
+        }
+        else
+            resetNightQuantiles();
+    }
+
+    for (size_t type = 0; type < AMSKY01Protocol::SENTENCE_COUNT; type++)
+    {
+        int64_t age = wallClock - state.received[type];
+        if (state.received[type] == 0 || age < 0 || age > maxAge)
+            continue;
+
+        AMSKY01Protocol::Sentence &sentence = weatherData.last[type];
+        sentence = AMSKY01Protocol::Sentence();
+        sentence.type = static_cast<AMSKY01Protocol::SentenceType>(type);
+        memcpy(sentence.fields, state.fields[type], sizeof(sentence.fields));
+        memcpy(sentence.outputs, state.outputs[type], sizeof(sentence.outputs));
+
+        const AMSKY01Protocol::SentenceSpec &spec = AMSKY01Protocol::SENTENCES[type];
+        for (size_t i = 0; i < spec.outputCount; i++)
+            ParametersNP[parameterIndex[spec.outputs[i]]].setValue(sentence.outputs[i]);
+
+        // Frames carry the restored values until the sensor reports, a
+        // partial first frame would publish zeros otherwise
+        frames.seed(sentence.type, sentence.outputs);
+
+        // Not valid for updateWeather, and the sensor goes stale after its
+        // timeout like any other if it does not report
+        sensors[type].lastReceived = now;
+        sensors[type].lastWall = state.received[type];
+        sensors[type].restored = true;
+        SensorFreshL[type].s = IPS_BUSY;
+        oldest = std::max(oldest, age / 1e9);
+        restored++;
+    }
+
+    if (restored == 0)
+        return;
+
+    // A baseline is only worth keeping together with the cloud sentence it
+    // came with, otherwise it is learnt again
+    resetCloudOnset();
+    if (state.onsetValid && sensors[static_cast<size_t>(AMSKY01Protocol::SentenceType::CLOUD)].restored)
+    {
+        cloudOnset.restoreBaseline(state.onsetMean, state.onsetVariance);
+        updateCloudOnsetScores();
+    }
+
+    SensorFreshLP.s = IPS_BUSY;
+    IDSetLight(&SensorFreshLP, nullptr);
+    ParametersNP.setState(IPS_BUSY);
+    ParametersNP.apply();
+    evaluateSafety();
+
+    LOGF_INFO("Restored the last weather of %zu sensors, up to %.0f s old, until they report.", restored, oldest);
+}
+
+void AMSKY01::storeWarmState()
+{
+    AMSKY01Protocol::WarmState state {};
+    state.saved = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch()).count();
+    for (size_t type = 0; type < AMSKY01Protocol::SENTENCE_COUNT; type++)
+    {
+        if (sensors[type].lastWall == 0)
+            continue;
+        state.received[type] = sensors[type].lastWall;
+        memcpy(state.fields[type], weatherData.last[type].fields, sizeof(state.fields[type]));
+        memcpy(state.outputs[type], weatherData.last[type].outputs, sizeof(state.outputs[type]));
+    }
+    state.onsetValid = cloudOnset.saveBaseline(state.onsetMean, state.onsetVariance);
+    static_assert(NIGHT_PARAMETER_COUNT * NIGHT_QUANTILE_COUNT == AMSKY01Protocol::WARM_NIGHT_QUANTILES,
+                  "warm state night quantiles out of sync");
+    state.nightStart = nightStart;
+    for (size_t p = 0; p < NIGHT_PARAMETER_COUNT; p++)
+        for (size_t q = 0; q < NIGHT_QUANTILE_COUNT; q++)
+            state.night[p * NIGHT_QUANTILE_COUNT + q] = nightQuantiles[p][q].save();
+
+    // Retried at the next interval, reported once per distinct error
+    warmDirty = false;
+    lastWarmSave = AMSKY01Protocol::monotonicNs();
+    if (!AMSKY01Protocol::saveWarmState(WarmStartFileT[0].text, state))
+    {
+        int error = errno;
+        if (error != warmStateError)
+            LOGF_ERROR("Cannot save the warm start state to %s: %s", WarmStartFileT[0].text, strerror(error));
+        warmStateError = error;
+        warmDirty = true;
+        return;
+    }
+    warmStateError = 0;
+}
+
+void AMSKY01::applyCloudOnsetSettings()
+{
+    cloudOnset.setDrift(CloudOnsetN[ONSET_DRIFT].value);
+    cloudOnset.setThreshold(CloudOnsetN[ONSET_THRESHOLD].value);
+    cloudOnset.setBaselineSamples(CloudOnsetN[ONSET_BASELINE].value);
+}
+
+void AMSKY01::updateCloudOnset()
+{
+    CloudOnsetL[0].s = cloudOnset.alarm() ? IPS_ALERT : IPS_OK;
+    CloudOnsetLP.s = CloudOnsetL[0].s;
+    IDSetLight(&CloudOnsetLP, nullptr);
+
+    if (cloudOnset.alarm())
+        LOG_WARN("Clouds arriving, the sky is warming above its clear sky baseline.");
+    else
+        LOG_INFO("Sky is back at its clear sky baseline.");
+
+    // Clients see the scores that tripped the alarm right away
+    updateCloudOnsetScores();
+}
+
+void AMSKY01::resetCloudOnset()
+{
+    cloudOnset.reset();
+    CloudOnsetL[0].s = IPS_IDLE;
+    CloudOnsetLP.s = IPS_IDLE;
+    IDSetLight(&CloudOnsetLP, nullptr);
+    updateCloudOnsetScores();
+}
+
+void AMSKY01::updateCloudOnsetScores()
+{
+    // Armed once the baseline is learnt
+    if (CloudOnsetLP.s == IPS_IDLE && !cloudOnset.learning())
+    {
+        CloudOnsetL[0].s = IPS_OK;
+        CloudOnsetLP.s = IPS_OK;
+        IDSetLight(&CloudOnsetLP, nullptr);
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < AMSKY01Protocol::CLOUD_SEGMENTS; i++)
+    {
+        double score = std::round(cloudOnset.score(i) * 100) / 100;
+        if (score != CloudOnsetScoreN[i].value)
+        {
+            CloudOnsetScoreN[i].value = score;
+            changed = true;
+        }
+    }
+
+    if (!changed)
+        return;
+
+    CloudOnsetScoreNP.s = cloudOnset.alarm() ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&CloudOnsetScoreNP, nullptr);
+}
+
+void AMSKY01::applySimulatorSettings()
+{
+    int scenario = IUFindOnSwitchIndex(&SimScenarioSP);
+    simulator.setScenario(static_cast<AMSKY01Protocol::Simulator::Scenario>(scenario < 0 ? 0 : scenario));
+    simulator.setRate(SimSettingsN[SIM_RATE].value);
+    simulator.setPeriod(SimSettingsN[SIM_PERIOD].value);
+}
+
+void AMSKY01::updateLatencyStats()
+{
+    uint64_t samples = 0;
+    for (size_t i = 0; i < STAGE_COUNT; i++)
+        samples += latency[i].count();
+
+    // Nothing new since the last report
+    if (samples == latencyReported && LatencyNP.s != IPS_IDLE)
+        return;
+    latencyReported = samples;
+
+    for (size_t i = 0; i < STAGE_COUNT; i++)
+    {
+        LatencyN[i * 3 + 0].value = latency[i].percentile(0.50) / 1000.0;
+        LatencyN[i * 3 + 1].value = latency[i].percentile(0.99) / 1000.0;
+        LatencyN[i * 3 + 2].value = latency[i].max() / 1000.0;
+    }
+
+    LatencyNP.s = IPS_OK;
+    IDSetNumber(&LatencyNP, nullptr);
+}
+
+void AMSKY01::checkFreshness(int64_t now)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+    {
+        if (sensors[i].lastReceived == 0 || sensors[i].stale)
+            continue;
+
+        double age = (now - sensors[i].lastReceived) / 1e9;
+        if (age <= SensorTimeoutN[i].value)
+            continue;
+
+        sensors[i].stale = true;
+        weatherData.valid[i] = false;
+        SensorFreshL[i].s = IPS_ALERT;
+        changed = true;
+        LOGF_WARN("%s sensor silent for %.0f s, its values are stale.", AMSKY01Protocol::SENTENCES[i].sensorLabel, age);
+    }
+
+    if (!changed)
+        return;
+
+    weatherData.dataValid = false;
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+        weatherData.dataValid |= weatherData.valid[i];
+
+    SensorFreshLP.s = IPS_ALERT;
+    IDSetLight(&SensorFreshLP, nullptr);
+
+    // The baseline no longer describes the sky the sensor comes back to
+    if (sensors[static_cast<size_t>(AMSKY01Protocol::SentenceType::CLOUD)].stale && !cloudOnset.learning())
+        resetCloudOnset();
+
+    ParametersNP.setState(IPS_ALERT);
+    ParametersNP.apply();
+    evaluateSafety();
+}
+
+void AMSKY01::updateSensorTiming(int64_t now)
+{
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+    {
+        INumber *timing = &SensorTimingN[i * TIMING_COUNT];
+        timing[TIMING_AGE].value = sensors[i].lastReceived ? (now - sensors[i].lastReceived) / 1e9 : 0;
+        timing[TIMING_MEAN].value = sensors[i].intervals.mean();
+        timing[TIMING_STDDEV].value = sensors[i].intervals.stddev();
+        timing[TIMING_MAX].value = sensors[i].intervals.max();
+    }
+
+    SensorTimingNP.s = SensorFreshLP.s == IPS_ALERT ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&SensorTimingNP, nullptr);
+}
+
+bool AMSKY01::readSerialData()
+{
+    if (ingestFD < 0)
+    {
+        return false;
+    }
+
+    // Called when the port is readable, take everything the kernel has
+    ssize_t nbytes_read = framer.readFrom(ingestFD);
+    
+    if (nbytes_read < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return true;
+
+        LOGF_ERROR("Serial read error: %s", strerror(errno));
+        stopIngest();
+        return false;
+    }
+    else if (nbytes_read == 0 && framer.space() > 0)
+    {
+        // EOF - device unplugged or replay finished, stop watching or the event loop spins
+        ingestEnded();
+        return false;
+    }
+
+    // Process every complete line, the partial tail stays in the ring
+    int64_t received = AMSKY01Protocol::monotonicNs();
+    captureChunk(nbytes_read, received);
+    framer.drain([this, received](const char *line, size_t length)
+    {
+        processData(line, length, received);
+    });
+    countRead(nbytes_read);
+    
+    return true;
+}
+
+void AMSKY01::countRead(ssize_t nbytes)
+{
+    streamCounters.bytesRead.fetch_add(static_cast<uint64_t>(nbytes), std::memory_order_relaxed);
+
+    uint64_t truncated = framer.truncatedLines();
+    if (truncated != framerTruncated)
+    {
+        streamCounters.truncated.fetch_add(truncated - framerTruncated, std::memory_order_relaxed);
+        framerTruncated = truncated;
+    }
+}
+
+void AMSKY01::processData(const char *data, size_t length, int64_t received)
+{
+    AMSKY01Protocol::Sentence sentence;
+    sentence.received = received;
+
+    AMSKY01Protocol::ParseResult result = AMSKY01Protocol::parseSentence(data, length, sentence);
+    streamCounters.count(result, sentence.type);
+
+    switch (result)
+    {
+        case AMSKY01Protocol::ParseResult::OK:
+            sentence.parsed = AMSKY01Protocol::monotonicNs();
+            applySentence(sentence);
+            break;
+
+        case AMSKY01Protocol::ParseResult::REPLY:
+            commandReply(data, length);
+            return;
+
+        // Counted in STREAM_HEALTH, a noisy line must not flood the log
+        case AMSKY01Protocol::ParseResult::MALFORMED:
+            LOGF_DEBUG("Malformed sentence: %s", data);
+            return;
+
+        // Ignoruj řádky nezačínající $ a neznámé zprávy
+        case AMSKY01Protocol::ParseResult::NOT_SENTENCE:
+        case AMSKY01Protocol::ParseResult::UNKNOWN_TAG:
+            break;
+    }
+    
+    // Log received data only in debug mode
+    if (isDebug())
+        LOGF_DEBUG("Received data: %s", data);
+}
+
+void AMSKY01::applySentence(const AMSKY01Protocol::Sentence &sentence)
+{
+    size_t type = static_cast<size_t>(sentence.type);
+
+    weatherData.last[type] = sentence;
+    weatherData.valid[type] = true;
+    weatherData.dataValid = true;
+
+    latency[STAGE_READ_PARSE].record(sentence.parsed - sentence.received);
+    frameTiming[type] = sentence;
+
+    // Freshness and inter-arrival statistics
+    auto &sensor = sensors[type];
+    if (sensor.lastReceived != 0 && !sensor.restored)
+        sensor.intervals.add((sentence.received - sensor.lastReceived) / 1e9);
+    sensor.lastReceived = sentence.received;
+
+    if (SensorFreshL[type].s != IPS_OK)
+    {
+        if (sensor.stale)
+            LOGF_INFO("%s sensor is reporting again.", AMSKY01Protocol::SENTENCES[type].sensorLabel);
+        sensor.stale = false;
+        sensor.restored = false;
+        SensorFreshL[type].s = IPS_OK;
+
+        // Alert for a silent sensor wins over busy for a restored one
+        SensorFreshLP.s = IPS_OK;
+        for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+            if (SensorFreshL[i].s > SensorFreshLP.s)
+                SensorFreshLP.s = SensorFreshL[i].s;
+        IDSetLight(&SensorFreshLP, nullptr);
+    }
+
+    const AMSKY01Protocol::SentenceSpec &spec = AMSKY01Protocol::SENTENCES[type];
+    double seconds = sentence.received / 1e9;
+    for (size_t i = 0; i < spec.outputCount; i++)
+    {
+        int slot = statsSlot[spec.outputs[i]];
+        if (slot >= 0)
+            for (WindowStats &stats : windowStats[slot])
+                stats.add(sentence.outputs[i], seconds);
+
+        if (sunUp)
+            continue;
+        int night = spec.outputs[i] == AMSKY01Protocol::SKY_BRIGHTNESS ? NIGHT_SKY_BRIGHTNESS :
+                    spec.outputs[i] == AMSKY01Protocol::CLOUD_COVER ? NIGHT_CLOUD_COVER : -1;
+        if (night < 0)
+            continue;
+        if (nightStart == 0)
+            nightStart = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::system_clock::now().time_since_epoch()).count();
+        for (P2Quantile &quantile : nightQuantiles[night])
+            quantile.add(sentence.outputs[i]);
+    }
+
+    // $cloud,seg1,seg2,seg3,seg4,seg5
+    if (sentence.type == AMSKY01Protocol::SentenceType::CLOUD && cloudOnset.add(sentence.fields))
+        updateCloudOnset();
+
+    evaluateSafety();
+
+    bool firstOfFrame = !frames.pending();
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch()).count();
+
+    for (size_t i = 0; i < spec.outputCount; i++)
+        history.add(spec.outputs[i], sentence.outputs[i], now / 1e9);
+    sensor.lastWall = now;
+    warmDirty = true;
+
+    // A value that changes a safety state goes out at once, past the
+    // deadband and the frame deadline, so the lights never wait for it
+    bool complete = frames.add(sentence, now);
+    bool urgent = safetyMoved(sentence);
+    if (complete || urgent)
+        publishFrame(urgent);
+    else if (firstOfFrame)
+        frameTimerID = IEAddTimer(static_cast<int>(FrameDeadlineN[0].value), frameDeadlineCallback, this);
+}
+
+void AMSKY01::resolveSafetyLights()
+{
+    for (size_t p = 0; p < AMSKY01Protocol::PARAMETER_COUNT; p++)
+    {
+        safetyLight[p] = -1;
+        for (size_t i = 0; i < critialParametersLP.size(); i++)
+            if (strcmp(critialParametersLP[i].getName(), AMSKY01Protocol::PARAMETERS[p].name) == 0)
+                safetyLight[p] = static_cast<int>(i);
+    }
+}
+
+IPState AMSKY01::parameterState(size_t parameter, double value) const
+{
+    // The rule of WeatherInterface::checkParameterState(), by index instead of by name
+    const INDI::PropertyNumber &range = ParametersRangeNP[parameterIndex[parameter]];
+    double minOk = range[0].getValue();
+    double maxOk = range[1].getValue();
+    double warning = (maxOk - minOk) * range[2].getValue() / 100;
+
+    if (value < minOk || value > maxOk)
+        return IPS_ALERT;
+    if ((minOk != 0 && value < minOk + warning) || (maxOk != 0 && value > maxOk - warning))
+        return IPS_BUSY;
+    return IPS_OK;
+}
+
+bool AMSKY01::safetyMoved(const AMSKY01Protocol::Sentence &sentence) const
+{
+    const AMSKY01Protocol::SentenceSpec &spec = AMSKY01Protocol::SENTENCES[static_cast<size_t>(sentence.type)];
+    for (size_t i = 0; i < spec.outputCount; i++)
+    {
+        size_t p = spec.outputs[i];
+        if (safetyLight[p] >= 0 &&
+                parameterState(p, sentence.outputs[i]) != parameterState(p, ParametersNP[parameterIndex[p]].getValue()))
+            return true;
+    }
+    return false;
+}
+
+void AMSKY01::evaluateSafety()
+{
+    // Judge the critical parameters on the published values as soon as they
+    // change instead of waiting for the base class update period. Every
+    // light is computed here from its limits and the sensor state.
+    IPState floor[AMSKY01Protocol::PARAMETER_COUNT];
+    std::fill(std::begin(floor), std::end(floor), IPS_IDLE);
+
+    // The last value of a silent sensor cannot be trusted, whatever it says,
+    // and a restored one is at best a warning until the sensor confirms it
+    for (size_t type = 0; type < AMSKY01Protocol::SENTENCE_COUNT; type++)
+    {
+        if (!sensors[type].stale && !sensors[type].restored)
+            continue;
+
+        const AMSKY01Protocol::SentenceSpec &spec = AMSKY01Protocol::SENTENCES[type];
+        for (size_t i = 0; i < spec.outputCount; i++)
+            floor[spec.outputs[i]] = sensors[type].stale ? IPS_ALERT : IPS_BUSY;
+    }
+
+    // An arriving cloud bank may close the roof before the cover crosses its limits
+    if (cloudOnset.alarm() && CloudOnsetSafetyS[ONSET_SAFETY_ENABLE].s == ISS_ON)
+        floor[AMSKY01Protocol::CLOUD_COVER] = IPS_ALERT;
+
+    IPState overall = IPS_IDLE;
+    for (size_t p = 0; p < AMSKY01Protocol::PARAMETER_COUNT; p++)
+    {
+        if (safetyLight[p] < 0)
+            continue;
+
+        IPState state = std::max(parameterState(p, ParametersNP[parameterIndex[p]].getValue()), floor[p]);
+        critialParametersLP[safetyLight[p]].setState(state);
+        overall = std::max(overall, state);
+    }
+    critialParametersLP.setState(overall);
+
+    // The base class applies the override only on its own update path,
+    // which updateWeather() bypasses
+    if (OverrideSP[0].getState() == ISS_ON)
+        critialParametersLP.setState(IPS_OK);
+
+    // Send only real changes, comparing with what clients last saw
+    size_t count = critialParametersLP.size();
+    bool changed = safetyStates.size() != count + 1;
+    safetyStates.resize(count + 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        changed |= safetyStates[i] != critialParametersLP[i].getState();
+        safetyStates[i] = critialParametersLP[i].getState();
+    }
+    changed |= safetyStates[count] != critialParametersLP.getState();
+    safetyStates[count] = critialParametersLP.getState();
+
+    if (!changed)
+        return;
+
+    critialParametersLP.apply();
+    storeSharedSnapshot();
+}
+
+void AMSKY01::frameDeadlineCallback(void *userpointer)
+{
+    AMSKY01 *device = static_cast<AMSKY01 *>(userpointer);
+
+    // The timer has fired, nothing left to remove
+    device->frameTimerID = -1;
+    if (device->frames.pending())
+        device->publishFrame();
+}
+
+void AMSKY01::publishFrame(bool force)
+{
+    if (frameTimerID >= 0)
+    {
+        IERmTimer(frameTimerID);
+        frameTimerID = -1;
+    }
+
+    const AMSKY01Protocol::Frame &frame = frames.close();
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // Local readers get every frame, the deadband only spares INDI clients
+    snapshot.sequence = frame.sequence;
+    snapshot.timestamp_ns = frame.timestamp;
+    snapshot.updated = frame.updated;
+    for (size_t i = 0; i < AMSKY01Protocol::PARAMETER_COUNT; i++)
+        snapshot.values[i] = frame.values[i];
+    storeSharedSnapshot();
+    publishFeed(frame);
+    if (archive.isOpen())
+        archive.append(frame.timestamp, frame.values);
+
+    // Send the vector only if a value left its deadband (or was silent for
+    // too long), or changed a safety state
+    bool changed = force;
+    for (size_t i = 0; i < AMSKY01Protocol::PARAMETER_COUNT; i++)
+    {
+        if (publishFilter.update(i, frame.values[i], now))
+            changed = true;
+    }
+
+    if (!changed)
+        return;
+
+    // The whole vector goes out, so every value becomes the new reference
+    for (size_t i = 0; i < AMSKY01Protocol::PARAMETER_COUNT; i++)
+    {
+        ParametersNP[parameterIndex[i]].setValue(frame.values[i]);
+        publishFilter.commit(i, frame.values[i], now);
+    }
+
+    ParametersNP.setState(SensorFreshLP.s == IPS_ALERT || SensorFreshLP.s == IPS_BUSY ? SensorFreshLP.s : IPS_OK);
+    ParametersNP.apply();
+    evaluateSafety();
+
+    int64_t published = AMSKY01Protocol::monotonicNs();
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+    {
+        if (!(frame.updated & (1u << i)))
+            continue;
+        latency[STAGE_PARSE_PUBLISH].record(published - frameTiming[i].parsed);
+        latency[STAGE_READ_PUBLISH].record(published - frameTiming[i].received);
+    }
+
+    int updated = 0;
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+        updated += (frame.updated >> i) & 1;
+
+    FrameN[FRAME_SEQUENCE].value = frame.sequence;
+    FrameN[FRAME_TIMESTAMP].value = frame.timestamp / 1e9;
+    FrameN[FRAME_SENSORS].value = updated;
+    FrameNP.s = (frame.updated == AMSKY01Protocol::FrameAssembler::COMPLETE) ? IPS_OK : IPS_BUSY;
+    IDSetNumber(&FrameNP, nullptr);
+}
+
+bool AMSKY01::openSharedSnapshot()
+{
+    const char *name = SharedNameT[0].text;
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        LOGF_ERROR("Cannot create shared memory %s: %s", name, strerror(errno));
+        return false;
+    }
+
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, sizeof(struct amsky01_shm)) == 0)
+        map = mmap(nullptr, sizeof(struct amsky01_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int savedErrno = errno;
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        LOGF_ERROR("Cannot map shared memory %s: %s", name, strerror(savedErrno));
+        shm_unlink(name);
+        return false;
+    }
+
+    // Readers check the header, fill it in last
+    sharedSnapshot = static_cast<struct amsky01_shm *>(map);
+    sharedSnapshot->size = sizeof(struct amsky01_shm);
+    sharedSnapshot->version = AMSKY01_SHM_VERSION;
+    __atomic_store_n(&sharedSnapshot->magic, AMSKY01_SHM_MAGIC, __ATOMIC_RELEASE);
+    sharedName = name;
+    storeSharedSnapshot();
+
+    LOGF_INFO("Publishing weather snapshots to shared memory %s.", name);
+    return true;
+}
+
+void AMSKY01::closeSharedSnapshot()
+{
+    if (sharedSnapshot == nullptr)
+        return;
+
+    // Tell readers that still have it mapped that nothing more is coming
+    snapshot.state = AMSKY01_SHM_STATE_IDLE;
+    storeSharedSnapshot();
+
+    munmap(sharedSnapshot, sizeof(struct amsky01_shm));
+    shm_unlink(sharedName.c_str());
+    sharedSnapshot = nullptr;
+}
+
+void AMSKY01::storeSharedSnapshot()
+{
+    if (sharedSnapshot == nullptr)
+        return;
+
+    snapshot.stale = 0;
+    for (size_t i = 0; i < AMSKY01Protocol::SENTENCE_COUNT; i++)
+        snapshot.stale |= sensors[i].stale ? (1u << i) : 0;
+    if (isConnected())
+        snapshot.state = critialParametersLP.getState();
+
+    amsky01_shm_store(sharedSnapshot, &snapshot);
+}
+
+bool AMSKY01::startFeed()
+{
+    if (!feed.listen(FeedPathT[0].text))
+    {
+        LOGF_ERROR("Cannot serve data feed on %s: %s", FeedPathT[0].text, strerror(errno));
+        return false;
+    }
+
+    feedCallbackID = IEAddCallback(feed.listenFD(), feedAcceptCallback, this);
+    LOGF_INFO("Serving data feed on %s.", FeedPathT[0].text);
+    updateFeedStatus();
+    return true;
+}
+
+void AMSKY01::stopFeed()
+{
+    for (const auto &subscriber : feedSubscribers)
+        IERmCallback(subscriber.second);
+    feedSubscribers.clear();
+
+    if (feedCallbackID >= 0)
+    {
+        IERmCallback(feedCallbackID);
+        feedCallbackID = -1;
+    }
+
+    feed.close();
+}
+
+void AMSKY01::feedAcceptCallback(int fd, void *userpointer)
+{
+    INDI_UNUSED(fd);
+    static_cast<AMSKY01 *>(userpointer)->acceptFeedSubscribers();
+}
+
+void AMSKY01::feedSubscriberCallback(int fd, void *userpointer)
+{
+    static_cast<AMSKY01 *>(userpointer)->serviceFeedSubscriber(fd);
+}
+
+void AMSKY01::acceptFeedSubscribers()
+{
+    int subscriber;
+    while ((subscriber = feed.accept()) >= 0)
+    {
+        feedSubscribers[subscriber] = IEAddCallback(subscriber, feedSubscriberCallback, this);
+        LOGF_DEBUG("Data feed subscriber connected on FD %d", subscriber);
+    }
+    updateFeedStatus();
+}
+
+void AMSKY01::serviceFeedSubscriber(int fd)
+{
+    if (feed.service(fd))
+        return;
+
+    // Hung up, the FD is already closed
+    auto subscriber = feedSubscribers.find(fd);
+    if (subscriber != feedSubscribers.end())
+    {
+        IERmCallback(subscriber->second);
+        feedSubscribers.erase(subscriber);
+    }
+    LOGF_DEBUG("Data feed subscriber on FD %d disconnected", fd);
+    updateFeedStatus();
+}
+
+void AMSKY01::publishFeed(const AMSKY01Protocol::Frame &frame)
+{
+    if (feed.subscribers() == 0)
+        return;
+
+    // Same keys as data.json of amsky01_viewer.py, readable by parseApiJson()
+    static const char *VALUE_KEYS[AMSKY01Protocol::PARAMETER_COUNT] =
+    {
+        "temp", "rh", "dew_point", "lux", "sqm", "cover", "sky", "t1", "t2", "t3", "t4", "center"
+    };
+    static const char *SENSOR_KEYS[AMSKY01Protocol::SENTENCE_COUNT] = { "hygro", "light", "cloud" };
+
+    char number[64];
+    std::string line;
+    line.reserve(512);
+
+    snprintf(number, sizeof(number), "{\"sequence\":%llu,\"timestamp\":%.3f,\"state\":\"%s\"",
+             static_cast<unsigned long long>(frame.sequence), frame.timestamp / 1e9,
+             pstateStr(critialParametersLP.getState()));
+    line += number;
+
+    for (size_t type = 0; type < AMSKY01Protocol::SENTENCE_COUNT; type++)
+    {
+        const AMSKY01Protocol::SentenceSpec &spec = AMSKY01Protocol::SENTENCES[type];
+        line += ",\"";
+        line += SENSOR_KEYS[type];
+        line += "\":{";
+        for (size_t i = 0; i < spec.outputCount; i++)
+        {
+            double value = frame.values[spec.outputs[i]];
+            if (std::isfinite(value))
+                snprintf(number, sizeof(number), "\"%s\":%.10g,", VALUE_KEYS[spec.outputs[i]], value);
+            else
+                snprintf(number, sizeof(number), "\"%s\":null,", VALUE_KEYS[spec.outputs[i]]);
+            line += number;
+        }
+        line += (frame.updated & (1u << type)) ? "\"updated\":true," : "\"updated\":false,";
+        line += sensors[type].stale ? "\"stale\":true}" : "\"stale\":false}";
+    }
+    line += "}";
+
+    feed.publish(line);
+}
+
+void AMSKY01::updateFeedStatus()
+{
+    FeedStatusN[FEED_SUBSCRIBERS].value = feed.subscribers();
+    FeedStatusN[FEED_DROPPED].value = feed.dropped();
+    FeedStatusNP.s = feed.listenFD() < 0 ? IPS_IDLE : (feed.dropped() > 0 ? IPS_BUSY : IPS_OK);
+    IDSetNumber(&FeedStatusNP, nullptr);
+}
+
+void AMSKY01::applyPublishFilterSettings()
+{
+    for (size_t i = 0; i < AMSKY01Protocol::PARAMETER_COUNT; i++)
+        publishFilter.setDeadband(i, DeadbandAbsN[i].value, DeadbandRelN[i].value / 100.0);
+
+    publishFilter.setMaxSilence(MaxSilenceN[0].value);
+}
+
+// Weather-specific functions
+IPState AMSKY01::updateWeather()
+{
+    // ParametersNP holds only published values, so the base class re-sends
+    // what clients already have and judges the lights on the values
+    // evaluateSafety() judged. It cannot see a silent, restored or clouding
+    // sensor though, and its re-sync would clear those states; alert and
+    // busy leave the lights alone until the sensor reports again.
+    evaluateSafety();
+
+    if (SensorFreshLP.s == IPS_ALERT)
+        return IPS_ALERT;
+    if (!weatherData.dataValid || SensorFreshLP.s == IPS_BUSY)
+        return IPS_BUSY;
+    if (cloudOnset.alarm() && CloudOnsetSafetyS[ONSET_SAFETY_ENABLE].s == ISS_ON)
+        return IPS_BUSY;
+    return IPS_OK;
 }
@@ -13,6 +13,28 @@
 #include <libindi/indiweather.h>
 #include <libindi/connectionplugins/connectionserial.h>
 
+#include "amsky01_protocol.h"
+#include "amsky01_spsc.h"
+#include "amsky01_filter.h"
+#include "amsky01_stats.h"
+#include "amsky01_simulator.h"
+#include "amsky01_capture.h"
+#include "amsky01_shm.h"
+#include "amsky01_feed.h"
+#include "amsky01_command.h"
+#include "amsky01_onset.h"
+#include "amsky01_state.h"
+#include "amsky01_sun.h"
+#include "amsky01_history.h"
+#include "amsky01_archive.h"
+
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace Connection
 {
     class Serial;
@@ -33,47 +55,376 @@ public:
 protected:
     virtual void TimerHit() override;
     virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+    virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+    virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
+    virtual bool Disconnect() override;
+    virtual bool saveConfigItems(FILE *fp) override;
+    virtual bool updateLocation(double latitude, double longitude, double elevation) override;
 
 private:
     // Serial connection - handled by base Weather class
     bool Handshake();
-    bool sendCommand(const char *cmd);
+
+    // Commands share the line with the sentence stream: queued, written
+    // without flushing, and answered by the '#' replies the framer splits off
+    void sendCommand(const char *cmd, CommandQueue::Callback done = nullptr, int timeoutMs = 1000);
+    void pumpCommands();
+    void armCommandTimer(int64_t deadline);
+    void commandReply(const char *line, size_t length);
+    static void commandTimeoutCallback(void *userpointer);
+    CommandQueue commands;
+    int commandTimerID{-1};
+    
+    // Event-driven ingestion: PortFD is watched by the INDI event loop and
+    // lines are parsed as soon as bytes arrive. TimerHit is housekeeping only.
+    static void serialReadCallback(int fd, void *userpointer);
+    void startIngest();
+    void stopIngest();
+    int serialCallbackID{-1};
+    int ingestFD{-1};   // PortFD, or the simulator/replay pipe in simulation
+    enum { SOURCE_PORT, SOURCE_SIMULATOR, SOURCE_REPLAY } ingestSource{SOURCE_PORT};
+    void ingestEnded();
+    AMSKY01Protocol::LineFramer framer;
+
+    // Raw capture of every chunk read, written by whichever thread reads
+    void captureChunk(ssize_t nbytes, int64_t received);
+    AMSKY01Protocol::CaptureWriter capture;
+    AMSKY01Protocol::Replayer replayer;
+
+    // Stream health, updated by whichever thread reads the port
+    void countRead(ssize_t nbytes);
+    AMSKY01Protocol::StreamCounters streamCounters;
+    uint64_t framerTruncated{0};    // framer.truncatedLines() already counted
+
+    // Optional reader thread: owns PortFD, frames and parses lines and hands
+    // the sentences to the INDI thread through a wait-free SPSC ring
+    void readerLoop();
+    static void queueReadyCallback(int fd, void *userpointer);
+    void drainQueue();
+    void updateQueueStats();
+    std::thread readerThread;
+    std::atomic<bool> readerRunning{false};
+    std::atomic<int> readerError{0};
+    int wakeFD{-1};     // reader -> INDI thread, samples are queued
+    int stopFD{-1};     // INDI thread -> reader, shut down
+    int queueCallbackID{-1};
+    SpscQueue<AMSKY01Protocol::Sentence, 256> sampleQueue;
+    struct Reply
+    {
+        char text[64];
+        size_t length;
+    };
+    SpscQueue<Reply, 8> replyQueue;
+    std::atomic<uint64_t> queueOverflows{0};
+    size_t queueHighWater{0};
     
     // Properties - pouze základní status
     ITextVectorProperty StatusTP;
     IText StatusT[2];  // Device a Status
+
+    // Last published frame
+    INumberVectorProperty FrameNP;
+    INumber FrameN[3];
+    enum { FRAME_SEQUENCE, FRAME_TIMESTAMP, FRAME_SENSORS };
+
+    // Frame publish deadline
+    INumberVectorProperty FrameDeadlineNP;
+    INumber FrameDeadlineN[1];
+
+    // Publication filter - per-parameter deadband and max silence
+    INumberVectorProperty DeadbandAbsNP;
+    INumber DeadbandAbsN[AMSKY01Protocol::PARAMETER_COUNT];
+    INumberVectorProperty DeadbandRelNP;
+    INumber DeadbandRelN[AMSKY01Protocol::PARAMETER_COUNT];
+    INumberVectorProperty MaxSilenceNP;
+    INumber MaxSilenceN[1];
+
+    // Sensor freshness
+    ILightVectorProperty SensorFreshLP;
+    ILight SensorFreshL[AMSKY01Protocol::SENTENCE_COUNT];
+    INumberVectorProperty SensorTimeoutNP;
+    INumber SensorTimeoutN[AMSKY01Protocol::SENTENCE_COUNT];
+
+    // Per sensor: age, mean/stddev/max interval
+    INumberVectorProperty SensorTimingNP;
+    INumber SensorTimingN[AMSKY01Protocol::SENTENCE_COUNT * 4];
+    enum { TIMING_AGE, TIMING_MEAN, TIMING_STDDEV, TIMING_MAX, TIMING_COUNT };
+
+    // Latency per stage: p50, p99, max
+    INumberVectorProperty LatencyNP;
+    INumber LatencyN[9];
+    ISwitchVectorProperty LatencyResetSP;
+    ISwitch LatencyResetS[1];
+
+    // Stream health: per sentence parsed/malformed/rate, then stream-wide counters
+    INumberVectorProperty StreamHealthNP;
+    INumber StreamHealthN[AMSKY01Protocol::SENTENCE_COUNT * 3 + 5];
+    enum { HEALTH_PARSED, HEALTH_MALFORMED, HEALTH_RATE, HEALTH_PER_SENTENCE };
+    enum { HEALTH_UNKNOWN_TAG, HEALTH_NOT_SENTENCE, HEALTH_TRUNCATED, HEALTH_BYTES_READ, HEALTH_REPLIES };
+
+    // Sliding window min/max/mean/stddev of the main parameters, window
+    // lengths in minutes
+    static constexpr size_t STATS_PARAMETER_COUNT = 4;
+    static constexpr size_t STATS_WINDOW_COUNT = 3;
+    enum { STATS_MIN, STATS_MAX, STATS_MEAN, STATS_STDDEV, STATS_PER_WINDOW };
+    INumberVectorProperty StatsWindowsNP;
+    INumber StatsWindowsN[STATS_WINDOW_COUNT];
+    INumberVectorProperty StatsNP[STATS_PARAMETER_COUNT];
+    INumber StatsN[STATS_PARAMETER_COUNT][STATS_WINDOW_COUNT * STATS_PER_WINDOW];
+
+    // Quantiles of the night so far, restarted at sunset or by hand
+    enum { NIGHT_SKY_BRIGHTNESS, NIGHT_CLOUD_COVER, NIGHT_PARAMETER_COUNT };
+    enum { NIGHT_P10, NIGHT_P50, NIGHT_P90, NIGHT_QUANTILE_COUNT };
+    INumberVectorProperty NightQuantilesNP;
+    INumber NightQuantilesN[NIGHT_PARAMETER_COUNT * NIGHT_QUANTILE_COUNT + 1];     // + samples
+    ISwitchVectorProperty NightResetSP;
+    ISwitch NightResetS[1];
+
+    // Hours covered by each rollup tier
+    INumberVectorProperty HistorySpanNP;
+    INumber HistorySpanN[RollupHistory::TIER_COUNT];
+
+    // History export, a tier sent as one BLOB on request
+    ISwitchVectorProperty HistoryExportSP;
+    ISwitch HistoryExportS[RollupHistory::TIER_COUNT];
+    ISwitchVectorProperty HistoryCompressSP;
+    ISwitch HistoryCompressS[2];
+    enum { HISTORY_COMPRESS_ON, HISTORY_COMPRESS_OFF };
+    IBLOBVectorProperty HistoryBP;
+    IBLOB HistoryB[1];
+
+    // Simulator scenario, line rate and scenario period
+    ISwitchVectorProperty SimScenarioSP;
+    ISwitch SimScenarioS[AMSKY01Protocol::Simulator::SCENARIO_COUNT];
+    INumberVectorProperty SimSettingsNP;
+    INumber SimSettingsN[2];
+    enum { SIM_RATE, SIM_PERIOD };
+
+    // Raw stream capture
+    ISwitchVectorProperty CaptureSP;
+    ISwitch CaptureS[2];
+    enum { CAPTURE_ENABLE, CAPTURE_DISABLE };
+    ITextVectorProperty CaptureFileTP;
+    IText CaptureFileT[1] {};
+
+    // Replay of a capture instead of the simulator
+    ISwitchVectorProperty ReplaySP;
+    ISwitch ReplayS[2];
+    enum { REPLAY_ENABLE, REPLAY_DISABLE };
+    ITextVectorProperty ReplayFileTP;
+    IText ReplayFileT[1] {};
+    INumberVectorProperty ReplaySpeedNP;
+    INumber ReplaySpeedN[1];
+
+    // Shared-memory snapshot for local readers
+    ISwitchVectorProperty SharedSnapshotSP;
+    ISwitch SharedSnapshotS[2];
+    enum { SHARED_ENABLE, SHARED_DISABLE };
+    ITextVectorProperty SharedNameTP;
+    IText SharedNameT[1] {};
+
+    // Local JSON feed
+    ISwitchVectorProperty FeedSP;
+    ISwitch FeedS[2];
+    enum { FEED_ENABLE, FEED_DISABLE };
+    ITextVectorProperty FeedPathTP;
+    IText FeedPathT[1] {};
+    INumberVectorProperty FeedStatusNP;
+    INumber FeedStatusN[2];
+    enum { FEED_SUBSCRIBERS, FEED_DROPPED };
+
+    // Firmware command typed by the user, sent through the command queue
+    ITextVectorProperty DeviceCommandTP;
+    IText DeviceCommandT[1] {};
+    ITextVectorProperty DeviceReplyTP;
+    IText DeviceReplyT[1] {};
+
+    // Cloud onset, raised as soon as a thermopile segment leaves its clear
+    // sky baseline
+    ILightVectorProperty CloudOnsetLP;
+    ILight CloudOnsetL[1];
+    INumberVectorProperty CloudOnsetNP;
+    INumber CloudOnsetN[3];
+    enum { ONSET_DRIFT, ONSET_THRESHOLD, ONSET_BASELINE };
+    ISwitchVectorProperty CloudOnsetSafetySP;
+    ISwitch CloudOnsetSafetyS[2];
+    enum { ONSET_SAFETY_ENABLE, ONSET_SAFETY_DISABLE };
+    INumberVectorProperty CloudOnsetScoreNP;
+    INumber CloudOnsetScoreN[AMSKY01Protocol::CLOUD_SEGMENTS];
+
+    // Warm start state file
+    ISwitchVectorProperty WarmStartSP;
+    ISwitch WarmStartS[2];
+    enum { WARM_START_ENABLE, WARM_START_DISABLE };
+    ITextVectorProperty WarmStartFileTP;
+    IText WarmStartFileT[1] {};
+    INumberVectorProperty WarmStartNP;
+    INumber WarmStartN[2];
+    enum { WARM_INTERVAL, WARM_MAX_AGE };
+
+    // Columnar archive of every frame
+    ISwitchVectorProperty ArchiveSP;
+    ISwitch ArchiveS[2];
+    enum { ARCHIVE_ENABLE, ARCHIVE_DISABLE };
+    ITextVectorProperty ArchiveDirTP;
+    IText ArchiveDirT[1] {};
+    INumberVectorProperty ArchiveStatusNP;
+    INumber ArchiveStatusN[2];
+    enum { ARCHIVE_ROWS, ARCHIVE_DROPPED };
+
+    // Serial reader mode
+    ISwitchVectorProperty ReaderModeSP;
+    ISwitch ReaderModeS[2];
+    enum { READER_MAIN_LOOP, READER_THREAD };
+
+    // Reader queue statistics (thread mode)
+    INumberVectorProperty ReaderQueueNP;
+    INumber ReaderQueueN[3];
+    enum { QUEUE_DEPTH, QUEUE_HIGH_WATER, QUEUE_OVERFLOWS };
     
     // Data reading
     bool readSerialData();
-    void processData(const std::string& data);
-    
-    // Weather data parsing
-    bool parseHygro(const std::string& data);
-    bool parseLight(const std::string& data);
-    bool parseCloud(const std::string& data);
+    void processData(const char *data, size_t length, int64_t received);
+    void applySentence(const AMSKY01Protocol::Sentence &sentence);
     
     // Weather values podle skutečných AMSKY01 dat
     struct {
-        // Hygro sensor
-        double temperature = 0.0;   // °C
-        double humidity = 0.0;      // %
-        double dewPoint = 0.0;      // °C (vypočítané)
-        
-        // Light sensor  
-        double lux = 0.0;           // světelnost
-        int raw1 = 0, raw2 = 0;     // raw hodnoty
-        int gain = 0;               // zesílení
-        int integrationTime = 0;    // integrační čas ms
-        double skyBrightness = 0.0; // mag/arcsec² (vypočítané)
-        
-        // Cloud sensor (thermopile)
-        double cloudTemp[5] = {0};  // 5 teplot oblohy (4 segmenty + zenit)
-        double avgCloudTemp = 0.0;  // průměrná teplota oblohy
-        double cloudCover = 0.0;    // oblačnost % (vypočítané)
-        
-        bool hygroValid = false;
-        bool lightValid = false;
-        bool cloudValid = false;
+        // Last sentence of each type, keeps raw fields such as light gain
+        AMSKY01Protocol::Sentence last[AMSKY01Protocol::SENTENCE_COUNT];
+        bool valid[AMSKY01Protocol::SENTENCE_COUNT] = {false};
         bool dataValid = false;
     } weatherData;
+
+    // Frame assembly: one coherent, timestamped publish per sensor cycle,
+    // or a partial one when the deadline expires first
+    static void frameDeadlineCallback(void *userpointer);
+    void publishFrame(bool force = false);
+
+    // Critical parameters and the overall weather state follow every
+    // published value and every change of the sensor state. ParametersNP
+    // holds only published values, the ones the base class judges too.
+    void evaluateSafety();
+    IPState parameterState(size_t parameter, double value) const;
+    bool safetyMoved(const AMSKY01Protocol::Sentence &sentence) const;
+    void resolveSafetyLights();
+    int safetyLight[AMSKY01Protocol::PARAMETER_COUNT];  // critialParametersLP element, -1 if not critical
+    std::vector<IPState> safetyStates;  // critical lights as last sent, overall state last
+
+    // Latest frame, stale sensors and weather state in POSIX shared memory,
+    // see amsky01_shm.h
+    bool openSharedSnapshot();
+    void closeSharedSnapshot();
+    void storeSharedSnapshot();
+    struct amsky01_shm *sharedSnapshot{nullptr};
+    std::string sharedName;     // name the open segment was created with
+    struct amsky01_shm_snapshot snapshot {};
+
+    // Every frame as one JSON line to local subscribers on a Unix socket,
+    // so other programs follow the sensor without opening the port
+    bool startFeed();
+    void stopFeed();
+    void publishFeed(const AMSKY01Protocol::Frame &frame);
+    void updateFeedStatus();
+    static void feedAcceptCallback(int fd, void *userpointer);
+    static void feedSubscriberCallback(int fd, void *userpointer);
+    void acceptFeedSubscribers();
+    void serviceFeedSubscriber(int fd);
+    FeedServer feed;
+    int feedCallbackID{-1};
+    std::map<int, int> feedSubscribers;     // FD -> event loop callback
+
+    // Latency from the wire to the clients, measured at read() return,
+    // parse completion and IDSetNumber completion
+    enum { STAGE_READ_PARSE, STAGE_PARSE_PUBLISH, STAGE_READ_PUBLISH, STAGE_COUNT };
+    void updateLatencyStats();
+    LatencyHistogram latency[STAGE_COUNT];
+    uint64_t latencyReported{0};
+    AMSKY01Protocol::Sentence frameTiming[AMSKY01Protocol::SENTENCE_COUNT];  // timestamps of the frame's sentences
+
+    // CUSUM per thermopile segment, trips seconds before the cloud cover
+    // average moves
+    void applyCloudOnsetSettings();
+    void updateCloudOnset();
+    void resetCloudOnset();
+    void updateCloudOnsetScores();
+    AMSKY01Protocol::CloudOnsetDetector cloudOnset;
+
+    // Simulation feeds the ingest path from a scenario generator
+    void applySimulatorSettings();
+    AMSKY01Protocol::Simulator simulator;
+    uint64_t simulatorOverruns{0};  // last reported
+
+    // Window statistics are fed from every sample and published at housekeeping
+    void applyStatsWindows();
+    void updateWindowStats(int64_t now);
+    WindowStats windowStats[STATS_PARAMETER_COUNT][STATS_WINDOW_COUNT];
+    int statsSlot[AMSKY01Protocol::PARAMETER_COUNT];    // row in StatsNP, -1 if not tracked
+
+    // Night quantiles are fed only while the Sun is down when the site is
+    // known, and restart when it sets
+    void resetNightQuantiles();
+    void updateNightQuantiles();
+    void trackSun();
+    P2Quantile nightQuantiles[NIGHT_PARAMETER_COUNT][NIGHT_QUANTILE_COUNT];
+    int64_t nightStart{0};      // UTC ns of the first sample since the restart, 0 while empty
+    int64_t nightRestored{0};   // UTC ns the restored quantiles were saved, until checked for a sunset
+    size_t nightSamplesReported{0};
+    bool siteKnown{false};
+    double siteLatitude{0};
+    double siteLongitude{0};
+    double sunAltitude{NAN};    // at the last housekeeping, NaN until known
+    bool sunUp{false};
+
+    // Every parameter rolled up at 1 s, 1 min, 15 min and 1 h in fixed rings,
+    // weeks of trend in constant memory
+    void updateHistorySpan();
+    bool sendHistory(size_t tier);
+    RollupHistory history;
+    std::vector<unsigned char> historyBlob;
+
+    // Last sentences and the cloud onset baseline saved every few seconds
+    // and shown again right after connecting, flagged until sensors report
+    void restoreWarmState();
+    void storeWarmState();
+    bool warmDirty{false};
+    int64_t lastWarmSave{0};    // monotonic ns
+    int warmStateError{0};      // last reported
+
+    // Every frame appended to daily columnar segments, see amsky01_archive.h
+    bool startArchive();
+    void updateArchiveStatus();
+    ArchiveWriter archive;
+    int archiveError{0};    // last reported
+
+    // Housekeeping, runs every polling period from TimerHit
+    void housekeeping();
+    int64_t lastHousekeeping{0};
+
+    // Lines per second from the parsed counters between two housekeeping runs
+    void updateStreamHealth(int64_t now);
+    uint64_t healthParsed[AMSKY01Protocol::SENTENCE_COUNT] = {0};
+    int64_t lastHealthUpdate{0};
+
+    // Per-sensor freshness: a sensor that stops reporting goes stale and its
+    // parameters are flagged instead of showing frozen values
+    void checkFreshness(int64_t now);
+    void updateSensorTiming(int64_t now);
+    struct
+    {
+        int64_t lastReceived = 0;   // monotonic ns, 0 = never
+        int64_t lastWall = 0;       // UTC ns of the last sentence, restored ones included
+        bool stale = false;
+        bool restored = false;      // values come from the warm start file
+        IntervalStats intervals;    // seconds between sentences
+    } sensors[AMSKY01Protocol::SENTENCE_COUNT];
+    AMSKY01Protocol::FrameAssembler frames;
+    int frameTimerID{-1};
+
+    // Only values that moved past their deadband reach the clients
+    void applyPublishFilterSettings();
+    PublishFilter publishFilter;
+
+    // ParametersNP element of every AMSKY01Protocol::Parameter, resolved once
+    // at registration so publishing never looks parameters up by name
+    size_t parameterIndex[AMSKY01Protocol::PARAMETER_COUNT] = {0};
 };
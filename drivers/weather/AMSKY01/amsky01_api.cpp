@@ -11,12 +11,53 @@
 #include "indicom.h"
 
 #include <curl/curl.h>
-#include <json/json.h>
+#include <chrono>
 #include <memory>
 #include <cmath>
+#include <cstdlib>
 
 static std::unique_ptr<AMSKY01_API> amsky01_api(new AMSKY01_API());
 
+struct ApiParameter
+{
+    const char *name;
+    const char *label;
+    double minOk;
+    double maxOk;
+    bool critical;
+};
+
+// Indexed by the AMSKY01_API::API_* parameter enum
+static const ApiParameter API_PARAMETERS[] =
+{
+    { "WEATHER_TEMPERATURE", "Temperature (°C)", -50, 80, true },
+    { "WEATHER_HUMIDITY", "Humidity (%)", 0, 100, true },
+    { "WEATHER_DEW_POINT", "Dew Point (°C)", -50, 50, true },
+    { "WEATHER_LIGHT_LUX", "Light (lux)", 0, 100000, false },
+    { "WEATHER_SKY_BRIGHTNESS", "Sky Brightness (mag/arcsec²)", 10, 25, false },
+    // Individual sky temperatures
+    { "WEATHER_SKY_TEMP_CENTER", "Sky Temp Center (°C)", -50, 50, true },
+};
+
+static const char *STATISTICS_TAB = "Statistics";
+
+// One poll per second for a whole UTC day
+static constexpr size_t ARCHIVE_ROWS_PER_DAY = 86400;
+
+// Parameters with sliding window statistics, one STATS_* vector each
+static const struct
+{
+    size_t parameter;   // AMSKY01_API::API_* index
+    const char *name;
+    const char *label;
+} STATS_PARAMETERS[] =
+{
+    { 0 /* API_TEMPERATURE */, "STATS_TEMPERATURE", "Temperature" },
+    { 1 /* API_HUMIDITY */, "STATS_HUMIDITY", "Humidity" },
+    { 4 /* API_SKY_BRIGHTNESS */, "STATS_SKY_BRIGHTNESS", "Sky Brightness" },
+    { 5 /* API_SKY_TEMP_CENTER */, "STATS_SKY_TEMP_CENTER", "Sky Temp Center" },
+};
+
 // Callback for libcurl to write data
 static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
 {
@@ -44,19 +85,96 @@ bool AMSKY01_API::initProperties()
     INDI::Weather::initProperties();
     
     // 2. ODSTRANĚNÍ CONNECTION TABU
-    addParameter("WEATHER_TEMPERATURE", "Temperature (°C)", -50, 80, 15);
-    addParameter("WEATHER_HUMIDITY", "Humidity (%)", 0, 100, 15);  
-    addParameter("WEATHER_DEW_POINT", "Dew Point (°C)", -50, 50, 15);
-    addParameter("WEATHER_LIGHT_LUX", "Light (lux)", 0, 100000, 15);
-    addParameter("WEATHER_SKY_BRIGHTNESS", "Sky Brightness (mag/arcsec²)", 10, 25, 15);
-    
-    // Individual sky temperatures
-    addParameter("WEATHER_SKY_TEMP_CENTER", "Sky Temp Center (°C)", -50, 50, 15);
-    
-    setCriticalParameter("WEATHER_TEMPERATURE");
-    setCriticalParameter("WEATHER_HUMIDITY");
-    setCriticalParameter("WEATHER_DEW_POINT");
-    setCriticalParameter("WEATHER_SKY_TEMP_CENTER");
+    for (size_t i = 0; i < API_PARAMETER_COUNT; i++)
+    {
+        const ApiParameter &spec = API_PARAMETERS[i];
+        addParameter(spec.name, spec.label, spec.minOk, spec.maxOk, 15);
+        parameterIndex[i] = ParametersNP.size() - 1;
+
+        if (spec.critical)
+            setCriticalParameter(spec.name);
+    }
+
+    // Publication filter, one deadband element per weather parameter
+    for (size_t i = 0; i < API_PARAMETER_COUNT; i++)
+    {
+        const ApiParameter &spec = API_PARAMETERS[i];
+        double span = spec.maxOk - spec.minOk;
+        IUFillNumber(&DeadbandAbsN[i], spec.name, spec.label, "%.3f", 0, span, span / 1000, 0);
+        IUFillNumber(&DeadbandRelN[i], spec.name, spec.label, "%.2f", 0, 100, 0.1, 0);
+    }
+    IUFillNumberVector(&DeadbandAbsNP, DeadbandAbsN, API_PARAMETER_COUNT, getDeviceName(),
+                       "PUBLISH_DEADBAND_ABS", "Deadband (units)", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumberVector(&DeadbandRelNP, DeadbandRelN, API_PARAMETER_COUNT, getDeviceName(),
+                       "PUBLISH_DEADBAND_REL", "Deadband (%)", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillNumber(&MaxSilenceN[0], "MAX_SILENCE", "Max Silence (s)", "%.f", 0, 3600, 10, 60);
+    IUFillNumberVector(&MaxSilenceNP, MaxSilenceN, 1, getDeviceName(), "PUBLISH_SILENCE", "Republish",
+                       OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    publishFilter.resize(API_PARAMETER_COUNT);
+    applyPublishFilterSettings();
+
+    // Sliding window statistics
+    static const double defaultWindows[STATS_WINDOW_COUNT] = { 1, 5, 15 };
+    char elementName[MAXINDINAME], elementLabel[MAXINDILABEL];
+    for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+    {
+        snprintf(elementName, sizeof(elementName), "WINDOW_%zu", w + 1);
+        snprintf(elementLabel, sizeof(elementLabel), "Window %zu (min)", w + 1);
+        IUFillNumber(&StatsWindowsN[w], elementName, elementLabel, "%.1f", 0.1, 1440, 1, defaultWindows[w]);
+    }
+    IUFillNumberVector(&StatsWindowsNP, StatsWindowsN, STATS_WINDOW_COUNT, getDeviceName(), "STATS_WINDOWS",
+                       "Windows", STATISTICS_TAB, IP_RW, 60, IPS_IDLE);
+
+    static const char *statsNames[STATS_PER_WINDOW] = { "MIN", "MAX", "MEAN", "STDDEV" };
+    static const char *statsLabels[STATS_PER_WINDOW] = { "min", "max", "mean", "stddev" };
+    for (size_t p = 0; p < STATS_PARAMETER_COUNT; p++)
+    {
+        for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+        {
+            for (size_t j = 0; j < STATS_PER_WINDOW; j++)
+            {
+                snprintf(elementName, sizeof(elementName), "W%zu_%s", w + 1, statsNames[j]);
+                snprintf(elementLabel, sizeof(elementLabel), "W%zu %s", w + 1, statsLabels[j]);
+                IUFillNumber(&StatsN[p][w * STATS_PER_WINDOW + j], elementName, elementLabel, "%.2f", -1e9, 1e9, 0, 0);
+            }
+        }
+        IUFillNumberVector(&StatsNP[p], StatsN[p], STATS_WINDOW_COUNT * STATS_PER_WINDOW, getDeviceName(),
+                           STATS_PARAMETERS[p].name, STATS_PARAMETERS[p].label, STATISTICS_TAB, IP_RO, 60, IPS_IDLE);
+    }
+
+    // History export
+    history.resize(API_PARAMETER_COUNT);
+    for (size_t t = 0; t < RollupHistory::TIER_COUNT; t++)
+    {
+        snprintf(elementName, sizeof(elementName), "TIER_%s", RollupHistory::TIERS[t].name);
+        snprintf(elementLabel, sizeof(elementLabel), "%s rollups", RollupHistory::TIERS[t].name);
+        IUFillSwitch(&HistoryExportS[t], elementName, elementLabel, ISS_OFF);
+    }
+    IUFillSwitchVector(&HistoryExportSP, HistoryExportS, RollupHistory::TIER_COUNT, getDeviceName(), "HISTORY_EXPORT",
+                       "Export", STATISTICS_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
+    IUFillSwitch(&HistoryCompressS[HISTORY_COMPRESS_ON], "ENABLE", "Compress", ISS_ON);
+    IUFillSwitch(&HistoryCompressS[HISTORY_COMPRESS_OFF], "DISABLE", "Raw", ISS_OFF);
+    IUFillSwitchVector(&HistoryCompressSP, HistoryCompressS, 2, getDeviceName(), "HISTORY_COMPRESS", "Export",
+                       STATISTICS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillBLOB(&HistoryB[0], "HISTORY", "History", ".amsh");
+    IUFillBLOBVector(&HistoryBP, HistoryB, 1, getDeviceName(), "HISTORY", "History", STATISTICS_TAB, IP_RO, 60, IPS_IDLE);
+
+    // Columnar archive
+    IUFillSwitch(&ArchiveS[ARCHIVE_ENABLE], "ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&ArchiveS[ARCHIVE_DISABLE], "DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&ArchiveSP, ArchiveS, 2, getDeviceName(), "ARCHIVE", "Archive",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    const char *home = getenv("HOME");
+    std::string archiveDir = std::string(home ? home : "/tmp") + "/.indi/amsky01_archive";
+    IUFillText(&ArchiveDirT[0], "DIR", "Directory", archiveDir.c_str());
+    IUFillTextVector(&ArchiveDirTP, ArchiveDirT, 1, getDeviceName(), "ARCHIVE_DIR", "Archive",
+                     OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+    IUFillNumber(&ArchiveStatusN[ARCHIVE_ROWS], "ROWS", "Rows today", "%.f", 0, 1e18, 0, 0);
+    IUFillNumber(&ArchiveStatusN[ARCHIVE_DROPPED], "DROPPED", "Dropped rows", "%.f", 0, 1e18, 0, 0);
+    IUFillNumberVector(&ArchiveStatusNP, ArchiveStatusN, 2, getDeviceName(), "ARCHIVE_STATUS", "Archive",
+                       OPTIONS_TAB, IP_RO, 60, IPS_IDLE);
 
     // API URL configuration
     IUFillText(&ApiUrlT[0], "API_URL", "API URL", apiUrl.c_str());
@@ -84,6 +202,29 @@ bool AMSKY01_API::updateProperties()
     {
         defineProperty(&StatusTP);
         defineProperty(&ApiUrlTP);
+        defineProperty(&DeadbandAbsNP);
+        defineProperty(&DeadbandRelNP);
+        defineProperty(&MaxSilenceNP);
+        loadConfig(true, DeadbandAbsNP.name);
+        loadConfig(true, DeadbandRelNP.name);
+        loadConfig(true, MaxSilenceNP.name);
+        publishFilter.reset();
+        defineProperty(&StatsWindowsNP);
+        loadConfig(true, StatsWindowsNP.name);
+        for (auto &statsVector : StatsNP)
+            defineProperty(&statsVector);
+        applyStatsWindows();
+        defineProperty(&HistoryExportSP);
+        defineProperty(&HistoryCompressSP);
+        defineProperty(&HistoryBP);
+        loadConfig(true, HistoryCompressSP.name);
+        defineProperty(&ArchiveSP);
+        defineProperty(&ArchiveDirTP);
+        defineProperty(&ArchiveStatusNP);
+        loadConfig(true, ArchiveDirTP.name);
+        loadConfig(true, ArchiveSP.name);
+        if (ArchiveS[ARCHIVE_ENABLE].s == ISS_ON && !archive.isOpen())
+            startArchive();
         
         IUSaveText(&StatusT[1], "Connected - Reading API");
         StatusTP.s = IPS_OK;
@@ -98,6 +239,19 @@ bool AMSKY01_API::updateProperties()
     {
         deleteProperty(StatusTP.name);
         deleteProperty(ApiUrlTP.name);
+        deleteProperty(DeadbandAbsNP.name);
+        deleteProperty(DeadbandRelNP.name);
+        deleteProperty(MaxSilenceNP.name);
+        archive.close();
+        deleteProperty(ArchiveSP.name);
+        deleteProperty(ArchiveDirTP.name);
+        deleteProperty(ArchiveStatusNP.name);
+        deleteProperty(HistoryExportSP.name);
+        deleteProperty(HistoryCompressSP.name);
+        deleteProperty(HistoryBP.name);
+        deleteProperty(StatsWindowsNP.name);
+        for (auto &statsVector : StatsNP)
+            deleteProperty(statsVector.name);
         
         LOG_INFO("Device disconnected");
     }
@@ -137,6 +291,9 @@ void AMSKY01_API::TimerHit()
     }
     
     readHTTPData();
+    updateWindowStats();
+    if (archive.isOpen())
+        updateArchiveStatus();
     SetTimer(getCurrentPollingPeriod());
 }
 
@@ -153,11 +310,117 @@ bool AMSKY01_API::ISNewText(const char *dev, const char *name, char *texts[], ch
             LOGF_INFO("API URL set to: %s", apiUrl.c_str());
             return true;
         }
+
+        // Used the next time the archive is enabled
+        if (strcmp(name, ArchiveDirTP.name) == 0)
+        {
+            IUUpdateText(&ArchiveDirTP, texts, names, n);
+            ArchiveDirTP.s = IPS_OK;
+            IDSetText(&ArchiveDirTP, nullptr);
+            return true;
+        }
     }
 
     return INDI::Weather::ISNewText(dev, name, texts, names, n);
 }
 
+bool AMSKY01_API::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
+{
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
+    {
+        // Publication filter
+        if (strcmp(name, DeadbandAbsNP.name) == 0 || strcmp(name, DeadbandRelNP.name) == 0 ||
+                strcmp(name, MaxSilenceNP.name) == 0)
+        {
+            INumberVectorProperty *nvp = (strcmp(name, DeadbandAbsNP.name) == 0) ? &DeadbandAbsNP :
+                                         (strcmp(name, DeadbandRelNP.name) == 0) ? &DeadbandRelNP : &MaxSilenceNP;
+            IUUpdateNumber(nvp, values, names, n);
+            applyPublishFilterSettings();
+            nvp->s = IPS_OK;
+            IDSetNumber(nvp, nullptr);
+            return true;
+        }
+
+        // Statistics windows, restart from the next sample
+        if (strcmp(name, StatsWindowsNP.name) == 0)
+        {
+            IUUpdateNumber(&StatsWindowsNP, values, names, n);
+            applyStatsWindows();
+            StatsWindowsNP.s = IPS_OK;
+            IDSetNumber(&StatsWindowsNP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::Weather::ISNewNumber(dev, name, values, names, n);
+}
+
+bool AMSKY01_API::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev != nullptr && strcmp(dev, getDeviceName()) == 0)
+    {
+        if (strcmp(name, HistoryExportSP.name) == 0)
+        {
+            IUUpdateSwitch(&HistoryExportSP, states, names, n);
+            int tier = IUFindOnSwitchIndex(&HistoryExportSP);
+            IUResetSwitch(&HistoryExportSP);
+            HistoryExportSP.s = (tier >= 0 && sendHistory(tier)) ? IPS_OK : IPS_ALERT;
+            IDSetSwitch(&HistoryExportSP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, HistoryCompressSP.name) == 0)
+        {
+            IUUpdateSwitch(&HistoryCompressSP, states, names, n);
+            HistoryCompressSP.s = IPS_OK;
+            IDSetSwitch(&HistoryCompressSP, nullptr);
+            return true;
+        }
+
+        if (strcmp(name, ArchiveSP.name) == 0)
+        {
+            IUUpdateSwitch(&ArchiveSP, states, names, n);
+            ArchiveSP.s = IPS_OK;
+
+            archive.close();
+            if (ArchiveS[ARCHIVE_ENABLE].s == ISS_ON && isConnected() && !startArchive())
+            {
+                IUResetSwitch(&ArchiveSP);
+                ArchiveS[ARCHIVE_DISABLE].s = ISS_ON;
+                ArchiveSP.s = IPS_ALERT;
+            }
+
+            IDSetSwitch(&ArchiveSP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::Weather::ISNewSwitch(dev, name, states, names, n);
+}
+
+bool AMSKY01_API::saveConfigItems(FILE *fp)
+{
+    INDI::Weather::saveConfigItems(fp);
+
+    IUSaveConfigNumber(fp, &DeadbandAbsNP);
+    IUSaveConfigNumber(fp, &DeadbandRelNP);
+    IUSaveConfigNumber(fp, &MaxSilenceNP);
+    IUSaveConfigNumber(fp, &StatsWindowsNP);
+    IUSaveConfigSwitch(fp, &HistoryCompressSP);
+    IUSaveConfigSwitch(fp, &ArchiveSP);
+    IUSaveConfigText(fp, &ArchiveDirTP);
+
+    return true;
+}
+
+void AMSKY01_API::applyPublishFilterSettings()
+{
+    for (size_t i = 0; i < API_PARAMETER_COUNT; i++)
+        publishFilter.setDeadband(i, DeadbandAbsN[i].value, DeadbandRelN[i].value / 100.0);
+
+    publishFilter.setMaxSilence(MaxSilenceN[0].value);
+}
+
 bool AMSKY01_API::readHTTPData()
 {
     CURL *curl;
@@ -203,72 +466,172 @@ bool AMSKY01_API::readHTTPData()
 
 bool AMSKY01_API::parseJSONData(const std::string& jsonData)
 {
-    Json::Value root;
-    Json::CharReaderBuilder builder;
     std::string errs;
-
-    std::istringstream s(jsonData);
-    if (!Json::parseFromStream(builder, s, &root, &errs))
+    if (!parseApiJson(jsonData, weatherData, errs))
     {
         LOGF_ERROR("Failed to parse JSON: %s", errs.c_str());
         return false;
     }
 
-    try
+    publishValues();
+
+    LOGF_DEBUG("Parsed data - Temp: %.2f°C, Humidity: %.2f%%, Lux: %.2f, SQM: %.2f",
+               weatherData.temperature, weatherData.humidity, weatherData.lux, weatherData.skyBrightness);
+
+    return true;
+}
+
+void AMSKY01_API::publishValues()
+{
+    const double values[API_PARAMETER_COUNT] =
     {
-        // Parse hygro data
-        if (root.isMember("hygro") && root["hygro"].isObject())
-        {
-            const Json::Value& hygro = root["hygro"];
-            if (!hygro["temp"].isNull())
-                weatherData.temperature = hygro["temp"].asDouble();
-            if (!hygro["rh"].isNull())
-                weatherData.humidity = hygro["rh"].asDouble();
-            if (!hygro["dew_point"].isNull())
-                weatherData.dewPoint = hygro["dew_point"].asDouble();
-                
-            setParameterValue("WEATHER_TEMPERATURE", weatherData.temperature);
-            setParameterValue("WEATHER_HUMIDITY", weatherData.humidity);
-            setParameterValue("WEATHER_DEW_POINT", weatherData.dewPoint);
-        }
+        weatherData.temperature,
+        weatherData.humidity,
+        weatherData.dewPoint,
+        weatherData.lux,
+        weatherData.skyBrightness,
+        weatherData.cloudTemp[4],
+    };
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    for (size_t p = 0; p < STATS_PARAMETER_COUNT; p++)
+        for (WindowStats &stats : windowStats[p])
+            stats.add(values[STATS_PARAMETERS[p].parameter], now);
+
+    // History and archive keep every poll, the deadband only spares INDI clients
+    int64_t wallClock = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    for (size_t i = 0; i < API_PARAMETER_COUNT; i++)
+        history.add(i, values[i], wallClock / 1e9);
+    if (archive.isOpen())
+        archive.append(wallClock, values);
+
+    // Send the vector only if a value left its deadband (or was silent for
+    // too long), or changed a safety state
+    bool changed = false;
+    for (size_t i = 0; i < API_PARAMETER_COUNT; i++)
+    {
+        if (publishFilter.update(i, values[i], now))
+            changed = true;
+        if (API_PARAMETERS[i].critical &&
+                parameterState(i, values[i]) != parameterState(i, ParametersNP[parameterIndex[i]].getValue()))
+            changed = true;
+    }
 
-        // Parse light data
-        if (root.isMember("light") && root["light"].isObject())
-        {
-            const Json::Value& light = root["light"];
-            if (!light["lux"].isNull())
-                weatherData.lux = light["lux"].asDouble();
-            if (!light["sqm"].isNull())
-                weatherData.skyBrightness = light["sqm"].asDouble();
-
-            setParameterValue("WEATHER_LIGHT_LUX", weatherData.lux);
-            setParameterValue("WEATHER_SKY_BRIGHTNESS", weatherData.skyBrightness);
-        }
+    if (!changed)
+        return;
+
+    // The whole vector goes out, so every value becomes the new reference
+    for (size_t i = 0; i < API_PARAMETER_COUNT; i++)
+    {
+        ParametersNP[parameterIndex[i]].setValue(values[i]);
+        publishFilter.commit(i, values[i], now);
+    }
+
+    ParametersNP.setState(IPS_OK);
+    ParametersNP.apply();
+    evaluateSafety();
+}
 
-        // Parse cloud data
-        if (root.isMember("cloud") && root["cloud"].isObject())
+void AMSKY01_API::applyStatsWindows()
+{
+    for (auto &parameterStats : windowStats)
+        for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
+            parameterStats[w].setWindow(StatsWindowsN[w].value * 60);
+}
+
+void AMSKY01_API::updateWindowStats()
+{
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    for (size_t p = 0; p < STATS_PARAMETER_COUNT; p++)
+    {
+        bool changed = false;
+        for (size_t w = 0; w < STATS_WINDOW_COUNT; w++)
         {
-            const Json::Value& cloud = root["cloud"];
-            
-            if (!cloud["center"].isNull())
+            WindowStats &stats = windowStats[p][w];
+            stats.expire(now);
+
+            const double values[STATS_PER_WINDOW] = { stats.min(), stats.max(), stats.mean(), stats.stddev() };
+            INumber *elements = &StatsN[p][w * STATS_PER_WINDOW];
+            for (size_t j = 0; j < STATS_PER_WINDOW; j++)
             {
-                weatherData.cloudTemp[4] = cloud["center"].asDouble();
-                setParameterValue("WEATHER_SKY_TEMP_CENTER", weatherData.cloudTemp[4]);
+                if (elements[j].value != values[j])
+                {
+                    elements[j].value = values[j];
+                    changed = true;
+                }
             }
         }
 
-        weatherData.dataValid = true;
-        
-        LOGF_DEBUG("Parsed data - Temp: %.2f°C, Humidity: %.2f%%, Lux: %.2f, SQM: %.2f",
-                   weatherData.temperature, weatherData.humidity, weatherData.lux, weatherData.skyBrightness);
-        
-        return true;
+        if (!changed)
+            continue;
+
+        StatsNP[p].s = windowStats[p][0].count() > 0 ? IPS_OK : IPS_IDLE;
+        IDSetNumber(&StatsNP[p], nullptr);
     }
-    catch (const std::exception& e)
+}
+
+bool AMSKY01_API::sendHistory(size_t tier)
+{
+    bool compress = HistoryCompressS[HISTORY_COMPRESS_ON].s == ISS_ON;
+    size_t size = history.pack(tier, compress, historyBlob);
+    if (size == 0)
+    {
+        LOGF_WARN("No %s history to export.", RollupHistory::TIERS[tier].name);
+        HistoryBP.s = IPS_ALERT;
+        IDSetBLOB(&HistoryBP, nullptr);
+        return false;
+    }
+
+    // Size is the uncompressed length, the .z suffix tells clients to inflate
+    HistoryB[0].blob = historyBlob.data();
+    HistoryB[0].bloblen = static_cast<int>(historyBlob.size());
+    HistoryB[0].size = static_cast<int>(size);
+    strncpy(HistoryB[0].format, compress ? ".amsh.z" : ".amsh", sizeof(HistoryB[0].format) - 1);
+    HistoryBP.s = IPS_OK;
+    IDSetBLOB(&HistoryBP, nullptr);
+
+    LOGF_INFO("Exported %s history, %zu bytes.", RollupHistory::TIERS[tier].name, historyBlob.size());
+    return true;
+}
+
+bool AMSKY01_API::startArchive()
+{
+    std::vector<std::string> names;
+    for (const ApiParameter &spec : API_PARAMETERS)
+        names.push_back(spec.name);
+
+    if (!archive.open(ArchiveDirT[0].text, "amsky01_api", names, ARCHIVE_ROWS_PER_DAY))
     {
-        LOGF_ERROR("Exception while parsing JSON: %s", e.what());
+        LOGF_ERROR("Cannot archive into %s: %s", ArchiveDirT[0].text, strerror(errno));
         return false;
     }
+
+    archiveError = 0;
+    LOGF_INFO("Archiving polls into %s.", ArchiveDirT[0].text);
+    return true;
+}
+
+void AMSKY01_API::updateArchiveStatus()
+{
+    // Segment errors are retried daily, report each new one once
+    int error = archive.failed();
+    if (error != archiveError)
+    {
+        if (error != 0)
+            LOGF_ERROR("Archive segment in %s unusable: %s", ArchiveDirT[0].text, strerror(error));
+        archiveError = error;
+    }
+
+    double rows = archive.rows();
+    double dropped = archive.dropped();
+    if (rows == ArchiveStatusN[ARCHIVE_ROWS].value && dropped == ArchiveStatusN[ARCHIVE_DROPPED].value)
+        return;
+
+    ArchiveStatusN[ARCHIVE_ROWS].value = rows;
+    ArchiveStatusN[ARCHIVE_DROPPED].value = dropped;
+    ArchiveStatusNP.s = (error != 0 || dropped > 0) ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&ArchiveStatusNP, nullptr);
 }
 
 IPState AMSKY01_API::updateWeather()
@@ -279,5 +642,38 @@ IPState AMSKY01_API::updateWeather()
         return IPS_ALERT;
     }
 
+    // ParametersNP holds only published values, so the base class re-sends
+    // what clients already have and judges the lights on the values
+    // evaluateSafety() judged
+    evaluateSafety();
+    return IPS_OK;
+}
+
+IPState AMSKY01_API::parameterState(size_t parameter, double value) const
+{
+    // The rule of WeatherInterface::checkParameterState(), by index instead of by name
+    const INDI::PropertyNumber &range = ParametersRangeNP[parameterIndex[parameter]];
+    double minOk = range[0].getValue();
+    double maxOk = range[1].getValue();
+    double warning = (maxOk - minOk) * range[2].getValue() / 100;
+
+    if (value < minOk || value > maxOk)
+        return IPS_ALERT;
+    if ((minOk != 0 && value < minOk + warning) || (maxOk != 0 && value > maxOk - warning))
+        return IPS_BUSY;
     return IPS_OK;
 }
+
+void AMSKY01_API::evaluateSafety()
+{
+    bool changed = syncCriticalParameters();
+
+    // The base class applies the override only on its own update path
+    if (OverrideSP[0].getState() == ISS_ON)
+        critialParametersLP.setState(IPS_OK);
+
+    changed |= critialParametersLP.getState() != safetyState;
+    safetyState = critialParametersLP.getState();
+    if (changed)
+        critialParametersLP.apply();
+}
@@ -12,7 +12,15 @@
 #pragma once
 
 #include <libindi/indiweather.h>
+
+#include "amsky01_filter.h"
+#include "amsky01_stats.h"
+#include "amsky01_history.h"
+#include "amsky01_archive.h"
+#include "amsky01_api_json.h"
+
 #include <string>
+#include <vector>
 
 class AMSKY01_API : public INDI::Weather
 {
@@ -29,6 +37,9 @@ public:
 protected:
     virtual void TimerHit() override;
     virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
+    virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+    virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+    virtual bool saveConfigItems(FILE *fp) override;
 
 private:
     // HTTP Connection
@@ -43,27 +54,82 @@ private:
     ITextVectorProperty StatusTP;
     IText StatusT[2];
     
+    // Weather parameters, in registration order
+    enum
+    {
+        API_TEMPERATURE,
+        API_HUMIDITY,
+        API_DEW_POINT,
+        API_LIGHT_LUX,
+        API_SKY_BRIGHTNESS,
+        API_SKY_TEMP_CENTER,
+        API_PARAMETER_COUNT
+    };
+    size_t parameterIndex[API_PARAMETER_COUNT] = {0};
+
+    // Publication filter - per-parameter deadband and max silence
+    INumberVectorProperty DeadbandAbsNP;
+    INumber DeadbandAbsN[API_PARAMETER_COUNT];
+    INumberVectorProperty DeadbandRelNP;
+    INumber DeadbandRelN[API_PARAMETER_COUNT];
+    INumberVectorProperty MaxSilenceNP;
+    INumber MaxSilenceN[1];
+    PublishFilter publishFilter;
+    void applyPublishFilterSettings();
+
+    // Sliding window min/max/mean/stddev of the main parameters, window
+    // lengths in minutes
+    static constexpr size_t STATS_PARAMETER_COUNT = 4;
+    static constexpr size_t STATS_WINDOW_COUNT = 3;
+    enum { STATS_MIN, STATS_MAX, STATS_MEAN, STATS_STDDEV, STATS_PER_WINDOW };
+    INumberVectorProperty StatsWindowsNP;
+    INumber StatsWindowsN[STATS_WINDOW_COUNT];
+    INumberVectorProperty StatsNP[STATS_PARAMETER_COUNT];
+    INumber StatsN[STATS_PARAMETER_COUNT][STATS_WINDOW_COUNT * STATS_PER_WINDOW];
+    WindowStats windowStats[STATS_PARAMETER_COUNT][STATS_WINDOW_COUNT];
+    void applyStatsWindows();
+    void updateWindowStats();
+
+    // Every parameter rolled up in fixed rings, a tier sent as one BLOB on
+    // request so clients sync hours of trend in a single round trip
+    ISwitchVectorProperty HistoryExportSP;
+    ISwitch HistoryExportS[RollupHistory::TIER_COUNT];
+    ISwitchVectorProperty HistoryCompressSP;
+    ISwitch HistoryCompressS[2];
+    enum { HISTORY_COMPRESS_ON, HISTORY_COMPRESS_OFF };
+    IBLOBVectorProperty HistoryBP;
+    IBLOB HistoryB[1];
+    bool sendHistory(size_t tier);
+    RollupHistory history;
+    std::vector<unsigned char> historyBlob;
+
+    // Every poll appended to daily columnar segments, see amsky01_archive.h
+    ISwitchVectorProperty ArchiveSP;
+    ISwitch ArchiveS[2];
+    enum { ARCHIVE_ENABLE, ARCHIVE_DISABLE };
+    ITextVectorProperty ArchiveDirTP;
+    IText ArchiveDirT[1] {};
+    INumberVectorProperty ArchiveStatusNP;
+    INumber ArchiveStatusN[2];
+    enum { ARCHIVE_ROWS, ARCHIVE_DROPPED };
+    bool startArchive();
+    void updateArchiveStatus();
+    ArchiveWriter archive;
+    int archiveError{0};    // last reported
+
     // Data reading
     bool readHTTPData();
     bool parseJSONData(const std::string& jsonData);
+    void publishValues();
+
+    // Critical parameters are judged on every publication. ParametersNP
+    // holds only published values, the ones the base class judges too.
+    void evaluateSafety();
+    IPState parameterState(size_t parameter, double value) const;
+    IPState safetyState{IPS_IDLE};  // overall state as last sent
     
     // Weather data structure
-    struct {
-        // Hygro sensor
-        double temperature = 0.0;
-        double humidity = 0.0;
-        double dewPoint = 0.0;
-        
-        // Light sensor  
-        double lux = 0.0;
-        double skyBrightness = 0.0;
-        
-        // Cloud sensor
-        double cloudTemp[5] = {0};
-        double avgCloudTemp = 0.0;
-        
-        bool dataValid = false;
-    } weatherData;
+    AMSKY01ApiData weatherData;
     
     std::string apiUrl = "http://localhost:8080/data.json";
 };
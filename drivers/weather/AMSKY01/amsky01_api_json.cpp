@@ -0,0 +1,63 @@
+/*
+    AMSKY01 API JSON payload
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2026 Astrometers
+*/
+
+#include "amsky01_api_json.h"
+
+#include <json/json.h>
+#include <sstream>
+
+bool parseApiJson(const std::string &json, AMSKY01ApiData &data, std::string &error)
+{
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+
+    std::istringstream s(json);
+    if (!Json::parseFromStream(builder, s, &root, &error))
+        return false;
+
+    try
+    {
+        // Parse hygro data
+        if (root.isMember("hygro") && root["hygro"].isObject())
+        {
+            const Json::Value& hygro = root["hygro"];
+            if (!hygro["temp"].isNull())
+                data.temperature = hygro["temp"].asDouble();
+            if (!hygro["rh"].isNull())
+                data.humidity = hygro["rh"].asDouble();
+            if (!hygro["dew_point"].isNull())
+                data.dewPoint = hygro["dew_point"].asDouble();
+        }
+
+        // Parse light data
+        if (root.isMember("light") && root["light"].isObject())
+        {
+            const Json::Value& light = root["light"];
+            if (!light["lux"].isNull())
+                data.lux = light["lux"].asDouble();
+            if (!light["sqm"].isNull())
+                data.skyBrightness = light["sqm"].asDouble();
+        }
+
+        // Parse cloud data
+        if (root.isMember("cloud") && root["cloud"].isObject())
+        {
+            const Json::Value& cloud = root["cloud"];
+
+            if (!cloud["center"].isNull())
+                data.cloudTemp[4] = cloud["center"].asDouble();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        error = e.what();
+        return false;
+    }
+
+    data.dataValid = true;
+    return true;
+}
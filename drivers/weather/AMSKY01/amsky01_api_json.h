@@ -0,0 +1,42 @@
+/*
+    AMSKY01 API JSON payload
+
+    Parsing of the amsky01_viewer.py data.json document, kept free of INDI
+    types so it can be benchmarked and reused outside the driver.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2026 Astrometers
+*/
+
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Latest values reported by the API.
+ */
+struct AMSKY01ApiData
+{
+    // Hygro sensor
+    double temperature = 0.0;
+    double humidity = 0.0;
+    double dewPoint = 0.0;
+
+    // Light sensor
+    double lux = 0.0;
+    double skyBrightness = 0.0;
+
+    // Cloud sensor
+    double cloudTemp[5] = {0};
+    double avgCloudTemp = 0.0;
+
+    bool dataValid = false;
+};
+
+/**
+ * @brief Update data with the values present in a data.json document.
+ *
+ * Values missing from the document keep their previous value.
+ * @return false with a message in error when the document cannot be parsed.
+ */
+bool parseApiJson(const std::string &json, AMSKY01ApiData &data, std::string &error);
@@ -0,0 +1,318 @@
+/*
+    Columnar weather archive
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_archive.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr int64_t NS_PER_DAY = 86400LL * 1000000000LL;
+
+// Floor division, so times before 1970 still land in the right day
+int64_t dayOf(int64_t time)
+{
+    int64_t day = time / NS_PER_DAY;
+    return (time % NS_PER_DAY < 0) ? day - 1 : day;
+}
+}
+
+size_t archiveSegmentSize(size_t columns, size_t capacity)
+{
+    return ARCHIVE_HEADER_SIZE + capacity * sizeof(int64_t) + columns * capacity * sizeof(float);
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close();
+}
+
+bool ArchiveWriter::open(const std::string &directory, const std::string &prefix,
+                         const std::vector<std::string> &names, size_t capacity)
+{
+    close();
+
+    if (names.empty() || names.size() > ARCHIVE_MAX_COLUMNS || capacity == 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST)
+        return false;
+
+    segmentDirectory = directory;
+    segmentPrefix = prefix;
+    columnNames = names;
+    segmentCapacity = capacity;
+    error = 0;
+    droppedRows = 0;
+    failedDay = -1;
+    return true;
+}
+
+void ArchiveWriter::close()
+{
+    closeSegment();
+    segmentDirectory.clear();
+}
+
+uint64_t ArchiveWriter::rows() const
+{
+    return header ? header->rows : 0;
+}
+
+bool ArchiveWriter::append(int64_t time, const double *values)
+{
+    if (!isOpen())
+        return false;
+
+    int64_t day = dayOf(time);
+    if (day != segmentDay)
+    {
+        closeSegment();
+        if (day == failedDay || !openSegment(day))
+        {
+            failedDay = day;
+            droppedRows++;
+            return false;
+        }
+    }
+
+    uint64_t row = header->rows;
+    if (row >= segmentCapacity)
+    {
+        droppedRows++;
+        return false;
+    }
+
+    times[row] = time;
+    for (size_t c = 0; c < columnNames.size(); c++)
+        columns[c * segmentCapacity + row] = static_cast<float>(values[c]);
+
+    // Publish the row only once every column holds it
+    __atomic_store_n(&header->rows, row + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool ArchiveWriter::openSegment(int64_t day)
+{
+    time_t midnight = static_cast<time_t>(day * 86400);
+    struct tm utc;
+    gmtime_r(&midnight, &utc);
+
+    char name[64];
+    strftime(name, sizeof(name), "-%Y-%m-%d.amsa", &utc);
+    std::string path = segmentDirectory + "/" + segmentPrefix + name;
+
+    size_t size = archiveSegmentSize(columnNames.size(), segmentCapacity);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        error = errno;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        error = errno;
+        ::close(fd);
+        return false;
+    }
+
+    // A segment of the right size without its magic was cut short before
+    // the header was written, and is started over
+    bool created = st.st_size == 0;
+    if (static_cast<size_t>(st.st_size) == size)
+    {
+        char magic[sizeof(ARCHIVE_MAGIC)] = {};
+        created = pread(fd, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic)) &&
+                  std::all_of(magic, magic + sizeof(magic), [](char c) { return c == 0; });
+    }
+
+    // Every block up front, a full disk is reported here instead of as
+    // SIGBUS when a row first touches a page that cannot be allocated
+    if (created)
+    {
+        int allocateError = posix_fallocate(fd, 0, static_cast<off_t>(size));
+        if (allocateError != 0)
+        {
+            // Leave an empty file for the next attempt rather than a short one
+            if (st.st_size == 0 && ftruncate(fd, 0) < 0)
+                allocateError = errno;
+            error = allocateError;
+            ::close(fd);
+            return false;
+        }
+    }
+    if (!created && static_cast<size_t>(st.st_size) != size)
+    {
+        error = EINVAL;
+        ::close(fd);
+        return false;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int mapError = errno;
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        error = mapError;
+        return false;
+    }
+
+    ArchiveHeader *h = static_cast<ArchiveHeader *>(map);
+    if (created)
+    {
+        memset(h, 0, sizeof(*h));
+        h->version = ARCHIVE_VERSION;
+        h->columns = static_cast<uint32_t>(columnNames.size());
+        h->capacity = segmentCapacity;
+        h->rows = 0;
+        h->day = day * 86400;
+        for (size_t c = 0; c < columnNames.size(); c++)
+            strncpy(h->names[c], columnNames[c].c_str(), ARCHIVE_NAME_SIZE - 1);
+
+        // Magic last, readers ignore a half written header
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(h->magic, ARCHIVE_MAGIC, sizeof(h->magic));
+    }
+    else
+    {
+        // Continue today's segment only if it has the same shape
+        bool same = memcmp(h->magic, ARCHIVE_MAGIC, sizeof(h->magic)) == 0 && h->version == ARCHIVE_VERSION &&
+                    h->columns == columnNames.size() && h->capacity == segmentCapacity;
+        for (size_t c = 0; same && c < columnNames.size(); c++)
+            same = strncmp(h->names[c], columnNames[c].c_str(), ARCHIVE_NAME_SIZE - 1) == 0;
+        if (!same)
+        {
+            munmap(map, size);
+            error = EINVAL;
+            return false;
+        }
+    }
+
+    header = h;
+    mappedSize = size;
+    times = reinterpret_cast<int64_t *>(static_cast<char *>(map) + ARCHIVE_HEADER_SIZE);
+    columns = reinterpret_cast<float *>(times + segmentCapacity);
+    segmentDay = day;
+    segmentPath = path;
+    error = 0;
+    return true;
+}
+
+void ArchiveWriter::closeSegment()
+{
+    if (header != nullptr)
+        munmap(header, mappedSize);
+
+    header = nullptr;
+    mappedSize = 0;
+    times = nullptr;
+    columns = nullptr;
+    segmentDay = -1;
+    segmentPath.clear();
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    close();
+}
+
+bool ArchiveReader::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        int statError = errno;
+        ::close(fd);
+        errno = statError;
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < ARCHIVE_HEADER_SIZE)
+    {
+        ::close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    int mapError = errno;
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        errno = mapError;
+        return false;
+    }
+
+    const ArchiveHeader *h = static_cast<const ArchiveHeader *>(map);
+    if (memcmp(h->magic, ARCHIVE_MAGIC, sizeof(h->magic)) != 0 || h->version != ARCHIVE_VERSION ||
+            h->columns == 0 || h->columns > ARCHIVE_MAX_COLUMNS || size < archiveSegmentSize(h->columns, h->capacity))
+    {
+        munmap(map, size);
+        errno = EINVAL;
+        return false;
+    }
+
+    header = h;
+    mappedSize = size;
+    timeColumn = reinterpret_cast<const int64_t *>(static_cast<const char *>(map) + ARCHIVE_HEADER_SIZE);
+    valueColumns = reinterpret_cast<const float *>(timeColumn + h->capacity);
+    return true;
+}
+
+void ArchiveReader::close()
+{
+    if (header != nullptr)
+        munmap(const_cast<ArchiveHeader *>(header), mappedSize);
+
+    header = nullptr;
+    mappedSize = 0;
+    timeColumn = nullptr;
+    valueColumns = nullptr;
+}
+
+size_t ArchiveReader::rows() const
+{
+    if (header == nullptr)
+        return 0;
+
+    uint64_t rows = __atomic_load_n(&header->rows, __ATOMIC_ACQUIRE);
+    return static_cast<size_t>(rows < header->capacity ? rows : header->capacity);
+}
+
+int ArchiveReader::column(const char *name) const
+{
+    for (size_t c = 0; header != nullptr && c < header->columns; c++)
+        if (strncmp(header->names[c], name, ARCHIVE_NAME_SIZE) == 0)
+            return static_cast<int>(c);
+    return -1;
+}
+
+const float *ArchiveReader::values(size_t column) const
+{
+    if (header == nullptr || column >= header->columns)
+        return nullptr;
+    return valueColumns + column * header->capacity;
+}
@@ -0,0 +1,159 @@
+/*
+    Columnar weather archive
+
+    Every frame of the AMSKY01 and AMSKY01 API drivers appended to daily
+    segment files: one timestamp column and one fixed-width column per
+    parameter. Writer and readers map the files, so appending is a few
+    stores and scanning a month is a pass over contiguous arrays.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    Segment layout, native byte order, one file per UTC day named
+    <prefix>-YYYY-MM-DD.amsa:
+
+        ArchiveHeader, padded to ARCHIVE_HEADER_SIZE
+        int64_t  time[capacity]                 UTC ns since 1970
+        float    column[columns][capacity]      one array per parameter
+
+    Rows 0 .. rows-1 are valid. rows is stored with release semantics after
+    the row is complete, so a reader that loads it with acquire semantics
+    sees whole rows even while the segment is being written.
+*/
+constexpr char ARCHIVE_MAGIC[8] = { 'A', 'M', 'S', 'K', 'Y', 'A', 'R', 'C' };
+constexpr uint32_t ARCHIVE_VERSION = 1;
+constexpr size_t ARCHIVE_HEADER_SIZE = 4096;
+constexpr size_t ARCHIVE_MAX_COLUMNS = 64;
+constexpr size_t ARCHIVE_NAME_SIZE = 32;
+
+struct ArchiveHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;       // parameter columns, time not included
+    uint64_t capacity;      // rows the segment has room for
+    uint64_t rows;          // rows written
+    int64_t day;            // UTC seconds of the segment's midnight
+    char names[ARCHIVE_MAX_COLUMNS][ARCHIVE_NAME_SIZE];
+};
+static_assert(sizeof(ArchiveHeader) <= ARCHIVE_HEADER_SIZE, "archive header must fit its page");
+
+/** @brief Total size of a segment with the given shape. */
+size_t archiveSegmentSize(size_t columns, size_t capacity);
+
+/**
+ * @brief Appends rows to the segment of the current UTC day.
+ *
+ * Each segment is created at its full size and mapped, so appending never
+ * calls into the kernel except when the day changes. An existing segment of
+ * the same shape is continued, e.g. after a driver restart. Rows past the
+ * capacity of a day are dropped and counted.
+ */
+class ArchiveWriter
+{
+    public:
+        ~ArchiveWriter();
+
+        /**
+         * @brief Start archiving into directory, created if missing.
+         * @return false with errno set when the directory cannot be used.
+         */
+        bool open(const std::string &directory, const std::string &prefix, const std::vector<std::string> &names,
+                  size_t capacity);
+        void close();
+
+        bool isOpen() const
+        {
+            return !segmentDirectory.empty();
+        }
+
+        /**
+         * @brief Append one row, values holds one value per column.
+         * @param time UTC ns since 1970.
+         * @return false when the row was dropped, see failed().
+         */
+        bool append(int64_t time, const double *values);
+
+        /** @brief errno of the last segment that could not be opened, 0 if none. */
+        int failed() const
+        {
+            return error;
+        }
+
+        /** @brief Rows in the current segment. */
+        uint64_t rows() const;
+        uint64_t dropped() const
+        {
+            return droppedRows;
+        }
+        const std::string &path() const
+        {
+            return segmentPath;
+        }
+
+    private:
+        bool openSegment(int64_t day);
+        void closeSegment();
+
+        std::string segmentDirectory;
+        std::string segmentPrefix;
+        std::vector<std::string> columnNames;
+        size_t segmentCapacity{0};
+
+        ArchiveHeader *header{nullptr};
+        size_t mappedSize{0};
+        int64_t *times{nullptr};
+        float *columns{nullptr};
+        int64_t segmentDay{-1};
+        int64_t failedDay{-1};      // do not retry a segment that failed until the day changes
+        std::string segmentPath;
+        int error{0};
+        uint64_t droppedRows{0};
+};
+
+/**
+ * @brief Read-only view of one segment, safe while it is being written.
+ */
+class ArchiveReader
+{
+    public:
+        ~ArchiveReader();
+
+        /** @return false with errno set when the file is not a segment. */
+        bool open(const std::string &path);
+        void close();
+
+        /** @brief Rows valid now, grows while the writer appends. */
+        size_t rows() const;
+        size_t columns() const
+        {
+            return header ? header->columns : 0;
+        }
+        int64_t day() const
+        {
+            return header ? header->day : 0;
+        }
+        /** @return the column index, -1 if there is no such column. */
+        int column(const char *name) const;
+
+        const int64_t *times() const
+        {
+            return timeColumn;
+        }
+        const float *values(size_t column) const;
+
+    private:
+        const ArchiveHeader *header{nullptr};
+        size_t mappedSize{0};
+        const int64_t *timeColumn{nullptr};
+        const float *valueColumns{nullptr};
+};
@@ -0,0 +1,247 @@
+/*
+    AMSKY01 raw stream capture and replay
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <vector>
+
+namespace AMSKY01Protocol
+{
+
+namespace
+{
+// Longest a replay sleeps or blocks before checking for stop()
+constexpr std::chrono::milliseconds STOP_CHECK(100);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const std::string &path)
+{
+    close();
+
+    fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+
+    uint32_t header[2] = { CAPTURE_VERSION, 0 };
+    if (fwrite(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC), 1, fp) != 1 || fwrite(header, sizeof(header), 1, fp) != 1)
+    {
+        int savedErrno = errno;
+        fclose(fp);
+        fp = nullptr;
+        errno = savedErrno;
+        return false;
+    }
+
+    error = 0;
+    written = 0;
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (fp == nullptr)
+        return;
+
+    if (fclose(fp) != 0 && error == 0)
+        error = errno;
+    fp = nullptr;
+}
+
+void CaptureWriter::write(int64_t received, const struct iovec *iov, int count)
+{
+    if (fp == nullptr)
+        return;
+
+    uint32_t length = 0;
+    for (int i = 0; i < count; i++)
+        length += static_cast<uint32_t>(iov[i].iov_len);
+
+    bool ok = fwrite(&received, sizeof(received), 1, fp) == 1 && fwrite(&length, sizeof(length), 1, fp) == 1;
+    for (int i = 0; ok && i < count; i++)
+        ok = iov[i].iov_len == 0 || fwrite(iov[i].iov_base, iov[i].iov_len, 1, fp) == 1;
+
+    if (!ok)
+    {
+        error = errno ? errno : EIO;
+        fclose(fp);
+        fp = nullptr;
+        return;
+    }
+
+    written.fetch_add(length, std::memory_order_relaxed);
+}
+
+Replayer::~Replayer()
+{
+    stop();
+}
+
+bool Replayer::start(const std::string &path, double factor)
+{
+    stop();
+
+    fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr)
+        return false;
+
+    char magic[sizeof(CAPTURE_MAGIC)];
+    uint32_t header[2];
+    if (fread(magic, sizeof(magic), 1, fp) != 1 || fread(header, sizeof(header), 1, fp) != 1 ||
+            memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0 || header[0] != CAPTURE_VERSION)
+    {
+        fclose(fp);
+        fp = nullptr;
+        errno = EINVAL;
+        return false;
+    }
+
+    // The player polls for space itself, see writeAll()
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        int savedErrno = errno;
+        fclose(fp);
+        fp = nullptr;
+        errno = savedErrno;
+        return false;
+    }
+    readFD = fds[0];
+    writeFD = fds[1];
+
+    speed = factor;
+    played = 0;
+    error = 0;
+    cutShort = false;
+    running = true;
+    thread = std::thread(&Replayer::run, this);
+    return true;
+}
+
+void Replayer::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+
+    if (writeFD >= 0)
+        ::close(writeFD);
+    if (readFD >= 0)
+        ::close(readFD);
+    readFD = writeFD = -1;
+
+    if (fp != nullptr)
+        fclose(fp);
+    fp = nullptr;
+}
+
+bool Replayer::writeAll(const char *data, size_t length)
+{
+    // Wait for the reader in short steps so stop() is never blocked for long
+    while (length > 0 && running.load(std::memory_order_relaxed))
+    {
+        struct pollfd pfd = { writeFD, POLLOUT, 0 };
+        if (poll(&pfd, 1, static_cast<int>(STOP_CHECK.count())) <= 0)
+            continue;
+
+        ssize_t n = ::write(writeFD, data, length);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            return false;
+        }
+
+        data += n;
+        length -= static_cast<size_t>(n);
+        played.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+    }
+
+    return length == 0;
+}
+
+void Replayer::endEarly()
+{
+    if (ferror(fp))
+        error = EIO;
+    else
+        cutShort = true;
+}
+
+void Replayer::run()
+{
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point begin = Clock::now();
+    int64_t first = 0;
+    bool haveFirst = false;
+    std::vector<char> chunk;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        // The file may only end between records
+        int64_t received;
+        uint32_t length;
+        size_t got = fread(&received, 1, sizeof(received), fp);
+        if (got == 0 && feof(fp))
+            break;
+        if (got != sizeof(received) || fread(&length, sizeof(length), 1, fp) != 1)
+        {
+            endEarly();
+            break;
+        }
+
+        // Every chunk was one read into the framer, a longer length is a
+        // corrupt file and must not size the buffer
+        if (length > LineFramer::CAPACITY)
+        {
+            error = EBADMSG;
+            break;
+        }
+
+        chunk.resize(length);
+        if (length > 0 && fread(chunk.data(), length, 1, fp) != 1)
+        {
+            endEarly();
+            break;
+        }
+
+        if (!haveFirst)
+        {
+            first = received;
+            haveFirst = true;
+        }
+
+        // Keep the recorded spacing, scaled by speed
+        if (speed > 0)
+        {
+            Clock::time_point due = begin + std::chrono::nanoseconds(static_cast<int64_t>((received - first) / speed));
+            while (running.load(std::memory_order_relaxed) && Clock::now() < due)
+                std::this_thread::sleep_until(std::min(due, Clock::now() + STOP_CHECK));
+        }
+
+        if (!writeAll(chunk.data(), chunk.size()))
+            break;
+    }
+
+    // End of recording: the reader sees EOF
+    ::close(writeFD);
+    writeFD = -1;
+}
+
+}
@@ -0,0 +1,145 @@
+/*
+    AMSKY01 raw stream capture and replay
+
+    A capture file holds the bytes exactly as read from the port, in the
+    chunks read() returned them, each with its monotonic receive time.
+    Replaying writes the chunks into a pipe with the original spacing, scaled
+    by a speed factor, so a recorded night goes through the same framing,
+    parsing and publishing as live data.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include "amsky01_protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+
+namespace AMSKY01Protocol
+{
+
+/*
+    File layout, native byte order:
+
+        char     magic[8]       "AMSKYCAP"
+        uint32_t version        CAPTURE_VERSION
+        uint32_t reserved
+
+    followed by records until end of file:
+
+        int64_t  received       monotonic ns, see monotonicNs()
+        uint32_t length
+        char     data[length]
+*/
+constexpr char CAPTURE_MAGIC[8] = { 'A', 'M', 'S', 'K', 'Y', 'C', 'A', 'P' };
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+/**
+ * @brief Appends read() chunks to a capture file.
+ *
+ * Used by exactly one thread at a time, the one reading the port. A write
+ * error closes the file and is reported through failed().
+ */
+class CaptureWriter
+{
+    public:
+        ~CaptureWriter();
+
+        /** @return false with errno set when the file cannot be created. */
+        bool open(const std::string &path);
+        void close();
+
+        bool isOpen() const
+        {
+            return fp != nullptr;
+        }
+
+        /** @brief Store one chunk, given as up to two spans. */
+        void write(int64_t received, const struct iovec *iov, int count);
+
+        /** @brief errno of the write that closed the file, 0 if none. */
+        int failed() const
+        {
+            return error.load(std::memory_order_relaxed);
+        }
+
+        uint64_t bytes() const
+        {
+            return written.load(std::memory_order_relaxed);
+        }
+
+    private:
+        FILE *fp{nullptr};
+        std::atomic<int> error{0};
+        std::atomic<uint64_t> written{0};
+};
+
+/**
+ * @brief Plays a capture file into a pipe on its own thread.
+ *
+ * The write end closes when the recording ends, so the reader sees EOF.
+ * A record no read could have produced ends the replay early and is
+ * reported through failed(), a record cut short through truncated().
+ */
+class Replayer
+{
+    public:
+        ~Replayer();
+
+        /**
+         * @brief Open a capture and start playing it.
+         * @param speed 1 for real time, N for N times faster, 0 for as fast as possible.
+         * @return false with errno set when the file is unreadable or not a capture.
+         */
+        bool start(const std::string &path, double speed);
+
+        /** @brief Stop playing and close the pipe. */
+        void stop();
+
+        /** @brief Read end of the pipe, -1 when stopped. */
+        int fd() const
+        {
+            return readFD;
+        }
+
+        uint64_t bytes() const
+        {
+            return played.load(std::memory_order_relaxed);
+        }
+
+        /** @brief errno of the record that ended the replay early, 0 if none. */
+        int failed() const
+        {
+            return error.load(std::memory_order_relaxed);
+        }
+
+        /** @brief The file ended inside a record, as a capture cut off by a crash does. */
+        bool truncated() const
+        {
+            return cutShort.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void run();
+        void endEarly();
+        bool writeAll(const char *data, size_t length);
+
+        std::thread thread;
+        std::atomic<bool> running{false};
+        FILE *fp{nullptr};
+        double speed{1};
+        int readFD{-1};
+        int writeFD{-1};
+        std::atomic<uint64_t> played{0};
+        std::atomic<int> error{0};
+        std::atomic<bool> cutShort{false};
+};
+
+}
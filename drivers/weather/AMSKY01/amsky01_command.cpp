@@ -0,0 +1,95 @@
+/*
+    AMSKY01 command queue
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_command.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+bool CommandQueue::submit(const std::string &command, int timeoutMs, Callback done)
+{
+    if (queue.size() - (inFlight ? 1 : 0) >= MAX_PENDING)
+    {
+        if (done)
+            done(false, "queue full");
+        return false;
+    }
+
+    queue.push_back(Command{command, timeoutMs, std::move(done)});
+    return true;
+}
+
+int64_t CommandQueue::pump(int64_t now)
+{
+    while (!inFlight && !queue.empty())
+    {
+        const Command &command = queue.front();
+
+        if (port < 0)
+        {
+            inFlight = true;
+            complete(true, "OK#");
+            continue;
+        }
+
+        // Commands are a few bytes, a short write means the port is broken
+        ssize_t written = write(port, command.text.data(), command.text.size());
+        if (written != static_cast<ssize_t>(command.text.size()))
+        {
+            inFlight = true;
+            complete(false, written < 0 ? strerror(errno) : "short write");
+            continue;
+        }
+
+        inFlight = true;
+        deadline = now + static_cast<int64_t>(command.timeoutMs) * 1000000;
+        return deadline;
+    }
+
+    return 0;
+}
+
+bool CommandQueue::reply(const char *line, size_t length)
+{
+    if (!inFlight)
+        return false;
+
+    complete(true, std::string(line, length));
+    return true;
+}
+
+int64_t CommandQueue::expire(int64_t now)
+{
+    if (inFlight && now >= deadline)
+        complete(false, "timeout");
+
+    return inFlight ? deadline : 0;
+}
+
+void CommandQueue::cancel()
+{
+    // Detach first, so a callback that resubmits does not loop forever
+    std::deque<Command> cancelled;
+    cancelled.swap(queue);
+    inFlight = false;
+
+    for (Command &command : cancelled)
+        if (command.done)
+            command.done(false, "cancelled");
+}
+
+void CommandQueue::complete(bool ok, const std::string &reply)
+{
+    // Pop first, the callback may submit the next command
+    Command command = std::move(queue.front());
+    queue.pop_front();
+    inFlight = false;
+
+    if (command.done)
+        command.done(ok, reply);
+}
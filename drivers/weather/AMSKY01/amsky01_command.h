@@ -0,0 +1,92 @@
+/*
+    AMSKY01 command queue
+
+    Commands share the serial line with the continuous sentence stream. The
+    queue sends one command at a time and takes its reply from the framed
+    stream, so no sentence is flushed or mistaken for a reply.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+
+/**
+ * @brief FIFO of commands with at most one in flight.
+ *
+ * Single threaded and independent of the event loop: the owner calls
+ * pump() to send, reply() for every '#' terminated line the framer hands
+ * out and expire() when the deadline returned by pump() has passed.
+ */
+class CommandQueue
+{
+    public:
+        /**
+         * @brief Completion of a command.
+         * @param ok false on timeout, write error or cancel.
+         * @param reply the reply including its '#', or the reason it failed.
+         */
+        typedef std::function<void(bool ok, const std::string &reply)> Callback;
+
+        /** @brief Where commands go. -1 answers every command with "OK#", for simulation. */
+        void setFD(int fd)
+        {
+            port = fd;
+        }
+
+        /** @brief Commands waiting besides the one in flight, more are refused. */
+        static constexpr size_t MAX_PENDING = 16;
+
+        /**
+         * @brief Queue a command.
+         * @return false when the queue is full; done has then been called.
+         */
+        bool submit(const std::string &command, int timeoutMs, Callback done);
+
+        /**
+         * @brief Send the next command if none is in flight.
+         * @return monotonic ns deadline of the command just sent, 0 if nothing was sent.
+         */
+        int64_t pump(int64_t now);
+
+        /** @brief Complete the command in flight. @return false if none was waiting. */
+        bool reply(const char *line, size_t length);
+
+        /**
+         * @brief Fail the command in flight if its deadline has passed.
+         * @return deadline of the command still in flight, 0 if none is.
+         */
+        int64_t expire(int64_t now);
+
+        /** @brief Fail every queued command, e.g. on disconnect. */
+        void cancel();
+
+        bool busy() const
+        {
+            return inFlight;
+        }
+        size_t pending() const
+        {
+            return queue.size();
+        }
+
+    private:
+        struct Command
+        {
+            std::string text;
+            int timeoutMs;
+            Callback done;
+        };
+
+        void complete(bool ok, const std::string &reply);
+
+        std::deque<Command> queue;     // front is in flight when inFlight is set
+        bool inFlight{false};
+        int64_t deadline{0};
+        int port{-1};
+};
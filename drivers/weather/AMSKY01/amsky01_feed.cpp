@@ -0,0 +1,206 @@
+/*
+    AMSKY01 local data feed
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_feed.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+// A socket file nobody accepts on is left over from a run that crashed
+bool abandoned(const struct sockaddr_un &address)
+{
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0)
+        return false;
+
+    bool refused = connect(probe, reinterpret_cast<const struct sockaddr *>(&address), sizeof(address)) < 0 &&
+                   errno == ECONNREFUSED;
+    ::close(probe);
+    return refused;
+}
+}
+
+FeedServer::~FeedServer()
+{
+    close();
+}
+
+bool FeedServer::listen(const std::string &path)
+{
+    close();
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // Only a stale socket is replaced, never another file or a live feed
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode) || !abandoned(address))
+        {
+            errno = EADDRINUSE;
+            return false;
+        }
+        unlink(path.c_str());
+    }
+    else if (errno != ENOENT)
+        return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        int savedErrno = errno;
+        ::close(fd);
+        errno = savedErrno;
+        return false;
+    }
+
+    // Owner and group only; nobody can connect before listen()
+    if (chmod(path.c_str(), 0660) < 0 || ::listen(fd, 8) < 0)
+    {
+        int savedErrno = errno;
+        ::close(fd);
+        unlink(path.c_str());
+        errno = savedErrno;
+        return false;
+    }
+
+    listener = fd;
+    socketPath = path;
+    droppedLines = 0;
+    return true;
+}
+
+void FeedServer::close()
+{
+    while (!clients.empty())
+        remove(clients.size() - 1);
+
+    if (listener >= 0)
+    {
+        ::close(listener);
+        unlink(socketPath.c_str());
+        listener = -1;
+    }
+}
+
+int FeedServer::accept()
+{
+    if (listener < 0)
+        return -1;
+
+    int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    clients.push_back(Subscriber{fd, {}, 0});
+    return fd;
+}
+
+bool FeedServer::service(int fd)
+{
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        if (clients[i].fd != fd)
+            continue;
+
+        char discard[256];
+        ssize_t n = read(fd, discard, sizeof(discard));
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+        {
+            remove(i);
+            return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void FeedServer::publish(const std::string &line)
+{
+    if (clients.empty())
+        return;
+
+    auto shared = std::make_shared<const std::string>(line + '\n');
+
+    for (Subscriber &subscriber : clients)
+    {
+        if (subscriber.failed)
+            continue;
+
+        // Drop the oldest complete lines, a partly sent one has to finish
+        while (subscriber.queue.size() >= MAX_QUEUED)
+        {
+            auto victim = subscriber.offset > 0 ? subscriber.queue.begin() + 1 : subscriber.queue.begin();
+            if (victim == subscriber.queue.end())
+                break;
+            subscriber.queue.erase(victim);
+            droppedLines++;
+        }
+
+        subscriber.queue.push_back(shared);
+        send(subscriber);
+    }
+}
+
+void FeedServer::flush()
+{
+    for (Subscriber &subscriber : clients)
+    {
+        if (!subscriber.failed)
+            send(subscriber);
+    }
+}
+
+void FeedServer::send(Subscriber &subscriber)
+{
+    while (!subscriber.queue.empty())
+    {
+        const std::string &line = *subscriber.queue.front();
+        ssize_t n = ::send(subscriber.fd, line.data() + subscriber.offset, line.size() - subscriber.offset,
+                           MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                subscriber.failed = true;
+                subscriber.queue.clear();
+            }
+            return;
+        }
+
+        subscriber.offset += static_cast<size_t>(n);
+        if (subscriber.offset < line.size())
+            return;
+
+        subscriber.queue.pop_front();
+        subscriber.offset = 0;
+    }
+}
+
+void FeedServer::remove(size_t index)
+{
+    ::close(clients[index].fd);
+    clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(index));
+}
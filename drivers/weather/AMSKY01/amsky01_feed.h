@@ -0,0 +1,94 @@
+/*
+    AMSKY01 local data feed
+
+    Serves parsed frames as line-delimited JSON on a Unix socket, so other
+    local processes (amsky01_viewer.py, scripts) can follow the sensor while
+    the driver owns the serial port.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Unix socket server fanning lines out to any number of subscribers.
+ *
+ * Non-blocking and single threaded: the owner watches listenFD() and every
+ * subscriber FD in its event loop and calls accept() and service().
+ * Subscribers are only removed by service() and close(), so the owner always
+ * knows which FDs to stop watching. Each subscriber has a bounded queue. One
+ * that falls behind loses its oldest lines, never a line cut in half, and
+ * never slows the others down.
+ */
+class FeedServer
+{
+    public:
+        static constexpr size_t MAX_QUEUED = 256;   // lines per subscriber
+
+        ~FeedServer();
+
+        /**
+         * @brief Listen on path, replacing a stale socket left there.
+         * @return false with errno set on failure.
+         */
+        bool listen(const std::string &path);
+
+        /** @brief Disconnect every subscriber and remove the socket. */
+        void close();
+
+        int listenFD() const
+        {
+            return listener;
+        }
+
+        /** @brief Accept a pending connection. @return its FD, -1 if none. */
+        int accept();
+
+        /**
+         * @brief Handle a readable subscriber FD. Input is ignored.
+         * @return false when the subscriber hung up and was removed.
+         */
+        bool service(int fd);
+
+        /** @brief Queue one line (without '\n') to every subscriber and send what fits. */
+        void publish(const std::string &line);
+
+        /** @brief Retry sending queued lines. */
+        void flush();
+
+        size_t subscribers() const
+        {
+            return clients.size();
+        }
+
+        /** @brief Lines dropped from full queues since listen(). */
+        uint64_t dropped() const
+        {
+            return droppedLines;
+        }
+
+    private:
+        struct Subscriber
+        {
+            int fd;
+            std::deque<std::shared_ptr<const std::string>> queue;
+            size_t offset = 0;  // bytes of queue.front() already sent
+            bool failed = false; // send error, removed when service() sees the hangup
+        };
+
+        void send(Subscriber &subscriber);
+        void remove(size_t index);
+
+        int listener{-1};
+        std::string socketPath;
+        std::vector<Subscriber> clients;
+        uint64_t droppedLines{0};
+};
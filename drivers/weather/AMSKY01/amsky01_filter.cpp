@@ -0,0 +1,70 @@
+/*
+    Weather value publication filter
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+void PublishFilter::resize(size_t count)
+{
+    channels.resize(count);
+}
+
+void PublishFilter::setDeadband(size_t index, double absolute, double relative)
+{
+    if (index >= channels.size())
+        return;
+
+    channels[index].absolute = absolute;
+    channels[index].relative = relative;
+}
+
+bool PublishFilter::update(size_t index, double value, double now)
+{
+    if (index >= channels.size())
+        return true;
+
+    Channel &channel = channels[index];
+
+    bool pass = !channel.valid;
+    if (!pass)
+    {
+        if (std::isnan(value) || std::isnan(channel.published))
+            pass = std::isnan(value) != std::isnan(channel.published);
+        else
+        {
+            double band = std::max(channel.absolute, channel.relative * std::fabs(channel.published));
+            pass = std::fabs(value - channel.published) > band;
+        }
+    }
+
+    if (!pass && maxSilence > 0 && now - channel.publishedAt >= maxSilence)
+        pass = true;
+
+    if (pass)
+        commit(index, value, now);
+
+    return pass;
+}
+
+void PublishFilter::commit(size_t index, double value, double now)
+{
+    if (index >= channels.size())
+        return;
+
+    Channel &channel = channels[index];
+    channel.published = value;
+    channel.publishedAt = now;
+    channel.valid = true;
+}
+
+void PublishFilter::reset()
+{
+    for (Channel &channel : channels)
+        channel.valid = false;
+}
@@ -0,0 +1,70 @@
+/*
+    Weather value publication filter
+
+    Decides which weather values are worth sending to INDI clients. Shared by
+    the AMSKY01 and AMSKY01 API drivers.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Per-parameter deadband with a maximum silence interval.
+ *
+ * A value is republished only when it moves away from the last *published*
+ * value by more than max(absolute, relative * |published|). Comparing with the
+ * published value rather than the previous sample gives hysteresis: jitter
+ * around a level never passes, a slow drift passes once it adds up. After
+ * maxSilence seconds without a publish the value is sent anyway.
+ */
+class PublishFilter
+{
+    public:
+        void resize(size_t count);
+
+        /** @brief absolute in parameter units, relative as a fraction (0.01 = 1 %). */
+        void setDeadband(size_t index, double absolute, double relative);
+
+        /** @brief Seconds after which a value is republished unchanged, 0 disables. */
+        void setMaxSilence(double seconds)
+        {
+            maxSilence = seconds;
+        }
+
+        /**
+         * @brief Offer a new value.
+         * @param now monotonic time in seconds.
+         * @return true if the value should be published, it then becomes the reference.
+         */
+        bool update(size_t index, double value, double now);
+
+        /** @brief Make value the reference without testing it, e.g. because it was sent along. */
+        void commit(size_t index, double value, double now);
+
+        /** @brief Last published value of a parameter. */
+        double published(size_t index) const
+        {
+            return channels[index].published;
+        }
+
+        /** @brief Forget everything published, the next value of every parameter passes. */
+        void reset();
+
+    private:
+        struct Channel
+        {
+            double absolute = 0;
+            double relative = 0;
+            double published = 0;
+            double publishedAt = 0;
+            bool valid = false;
+        };
+
+        std::vector<Channel> channels;
+        double maxSilence = 0;
+};
@@ -0,0 +1,157 @@
+/*
+    Rollup history for the weather drivers
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <zlib.h>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "history export copies the ring as little-endian");
+static_assert(sizeof(RollupHistory::Cell) == 24, "history export layout");
+
+// 15 min of seconds, a day of minutes, a month of quarter hours, a year of hours
+const RollupHistory::TierSpec RollupHistory::TIERS[TIER_COUNT] =
+{
+    { "1s", 1, 900 },
+    { "1m", 60, 1440 },
+    { "15m", 900, 2976 },
+    { "1h", 3600, 8784 },
+};
+
+void RollupHistory::resize(size_t parameters)
+{
+    parameterCount = parameters;
+    for (size_t t = 0; t < TIER_COUNT; t++)
+        tiers[t].cells.assign(TIERS[t].capacity * parameterCount, Cell());
+    clear();
+}
+
+void RollupHistory::clear()
+{
+    for (size_t t = 0; t < TIER_COUNT; t++)
+    {
+        tiers[t].slots.assign(TIERS[t].capacity, -1);
+        tiers[t].newest = tiers[t].first = -1;
+    }
+}
+
+void RollupHistory::add(size_t parameter, double value, double now)
+{
+    if (parameter >= parameterCount || !std::isfinite(value))
+        return;
+
+    for (size_t t = 0; t < TIER_COUNT; t++)
+    {
+        Tier &tier = tiers[t];
+        int64_t slot = static_cast<int64_t>(std::floor(now / TIERS[t].width));
+
+        // Late samples of a bucket that already left the ring are dropped
+        size_t position = static_cast<size_t>(slot % static_cast<int64_t>(TIERS[t].capacity));
+        if (tier.slots[position] != slot)
+        {
+            if (tier.newest >= 0 && slot <= tier.newest - static_cast<int64_t>(TIERS[t].capacity))
+                continue;
+
+            tier.slots[position] = slot;
+            Cell *cells = &tier.cells[position * parameterCount];
+            std::fill(cells, cells + parameterCount, Cell());
+            if (tier.first < 0)
+                tier.first = slot;
+        }
+        tier.newest = std::max(tier.newest, slot);
+
+        Cell &cell = tier.cells[position * parameterCount + parameter];
+        float sample = static_cast<float>(value);
+        if (cell.count == 0)
+            cell.min = cell.max = sample;
+        else
+        {
+            cell.min = std::min(cell.min, sample);
+            cell.max = std::max(cell.max, sample);
+        }
+        cell.sum += value;
+        cell.count++;
+    }
+}
+
+int64_t RollupHistory::oldest(size_t tier) const
+{
+    return std::max(tiers[tier].first, tiers[tier].newest - static_cast<int64_t>(TIERS[tier].capacity) + 1);
+}
+
+const RollupHistory::Cell *RollupHistory::cell(size_t tier, int64_t slot, size_t parameter) const
+{
+    if (tier >= TIER_COUNT || parameter >= parameterCount || slot < 0)
+        return nullptr;
+
+    size_t position = static_cast<size_t>(slot % static_cast<int64_t>(TIERS[tier].capacity));
+    if (tiers[tier].slots[position] != slot)
+        return nullptr;
+
+    const Cell &result = tiers[tier].cells[position * parameterCount + parameter];
+    return result.count > 0 ? &result : nullptr;
+}
+
+size_t RollupHistory::pack(size_t tier, bool compress, std::vector<unsigned char> &out) const
+{
+    out.clear();
+    if (tier >= TIER_COUNT || tiers[tier].newest < 0)
+        return 0;
+
+    const Tier &source = tiers[tier];
+    size_t capacity = TIERS[tier].capacity;
+    int64_t first = oldest(tier);
+    uint64_t rows = static_cast<uint64_t>(source.newest - first + 1);
+    uint32_t version = HISTORY_VERSION;
+    uint32_t parameters = static_cast<uint32_t>(parameterCount);
+    int64_t width = TIERS[tier].width;
+
+    size_t headerSize = sizeof(HISTORY_MAGIC) + 2 * sizeof(uint32_t) + 2 * sizeof(int64_t) + sizeof(uint64_t);
+    size_t rowSize = parameterCount * sizeof(Cell);
+    size_t size = headerSize + rows * (sizeof(int64_t) + rowSize);
+    std::vector<unsigned char> raw(size);
+
+    unsigned char *p = raw.data();
+    auto put = [&p](const void *data, size_t length)
+    {
+        memcpy(p, data, length);
+        p += length;
+    };
+    put(HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+    put(&version, sizeof(version));
+    put(&parameters, sizeof(parameters));
+    put(&width, sizeof(width));
+    put(&first, sizeof(first));
+    put(&rows, sizeof(rows));
+
+    // The rows wrap around the end of the ring at most once
+    size_t start = static_cast<size_t>(first % static_cast<int64_t>(capacity));
+    size_t head = std::min<size_t>(rows, capacity - start);
+    size_t tail = rows - head;
+    put(&source.slots[start], head * sizeof(int64_t));
+    put(&source.slots[0], tail * sizeof(int64_t));
+    put(&source.cells[start * parameterCount], head * rowSize);
+    put(source.cells.data(), tail * rowSize);
+
+    if (!compress)
+    {
+        out.swap(raw);
+        return size;
+    }
+
+    uLongf compressed = compressBound(size);
+    out.resize(compressed);
+    if (compress2(out.data(), &compressed, raw.data(), size, Z_BEST_SPEED) != Z_OK)
+    {
+        out.clear();
+        return 0;
+    }
+    out.resize(compressed);
+    return size;
+}
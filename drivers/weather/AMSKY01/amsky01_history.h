@@ -0,0 +1,114 @@
+/*
+    Rollup history for the weather drivers
+
+    Min, max, mean and count of every parameter at several resolutions,
+    each kept in a fixed ring so the driver can hold weeks of trend in
+    constant memory.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+    Export layout, little-endian, see RollupHistory::pack():
+
+        char     magic[8]       "AMSKYHIS"
+        uint32_t version        HISTORY_VERSION
+        uint32_t parameters
+        int64_t  width          seconds per bucket
+        int64_t  first          slot number of row 0, it starts at first * width UTC seconds
+        uint64_t rows
+        int64_t  slots[rows]    slot number held by each row; a row whose slot is not
+                                first + index is a gap without samples
+        Cell     cells[rows][parameters]
+
+    Cells are stored as in memory: float min, float max, double sum,
+    uint32 count, uint32 reserved.
+*/
+constexpr char HISTORY_MAGIC[8] = { 'A', 'M', 'S', 'K', 'Y', 'H', 'I', 'S' };
+constexpr uint32_t HISTORY_VERSION = 1;
+
+/**
+ * @brief Tiered rollups: 1 s, 1 min, 15 min and 1 h buckets.
+ *
+ * A bucket is identified by its slot number, time / width, and lives at
+ * slot % capacity in its tier. A sample updates the current bucket of every
+ * tier. Starting a new bucket clears only that ring position, and stale
+ * positions are recognised by their slot number, so a sample always costs
+ * the same, even after a long gap.
+ */
+class RollupHistory
+{
+    public:
+        struct TierSpec
+        {
+            const char *name;
+            int64_t width;      // seconds
+            size_t capacity;    // buckets
+        };
+        static constexpr size_t TIER_COUNT = 4;
+        static const TierSpec TIERS[TIER_COUNT];
+
+        struct Cell
+        {
+            float min;
+            float max;
+            double sum;
+            uint32_t count;
+            uint32_t reserved;  // keeps the layout free of padding for export
+
+            double mean() const
+            {
+                return count > 0 ? sum / count : 0.0;
+            }
+        };
+
+        /** @brief Number of parameters per bucket, clears the history. */
+        void resize(size_t parameters);
+        size_t parameters() const
+        {
+            return parameterCount;
+        }
+
+        /** @param now UTC seconds since 1970. */
+        void add(size_t parameter, double value, double now);
+
+        void clear();
+
+        /** @brief Slot number of the newest bucket of a tier, -1 when empty. */
+        int64_t newest(size_t tier) const
+        {
+            return tiers[tier].newest;
+        }
+
+        /** @brief Oldest slot number the ring still holds, meaningful when newest() >= 0. */
+        int64_t oldest(size_t tier) const;
+
+        /**
+         * @brief Serialise a tier oldest bucket first, straight from the ring.
+         * @param compress zlib-compress the result.
+         * @return size before compression, 0 when the tier is empty or compression failed.
+         */
+        size_t pack(size_t tier, bool compress, std::vector<unsigned char> &out) const;
+
+        /** @brief A bucket, nullptr when the ring no longer or never held it. */
+        const Cell *cell(size_t tier, int64_t slot, size_t parameter) const;
+
+    private:
+        struct Tier
+        {
+            std::vector<int64_t> slots;     // slot number held at each ring position, -1 = none
+            std::vector<Cell> cells;        // capacity * parameterCount
+            int64_t newest = -1;
+            int64_t first = -1;             // first slot since clear()
+        };
+
+        Tier tiers[TIER_COUNT];
+        size_t parameterCount = 0;
+};
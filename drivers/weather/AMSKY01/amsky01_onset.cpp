@@ -0,0 +1,132 @@
+/*
+    AMSKY01 cloud onset detector
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_onset.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace AMSKY01Protocol
+{
+
+namespace
+{
+// Noise floor in ADU, keeps a very quiet segment from tripping on a single count
+constexpr double MIN_SIGMA = 2.0;
+
+// Sum ceiling in thresholds, bounds the samples needed to clear the alarm
+constexpr double SUM_CAP = 2.0;
+}
+
+CloudOnsetDetector::CloudOnsetDetector()
+{
+    reset();
+}
+
+void CloudOnsetDetector::setBaselineSamples(double count)
+{
+    weight = 1.0 / std::max(count, 1.0);
+}
+
+void CloudOnsetDetector::reset()
+{
+    for (Segment &segment : state)
+        segment = Segment{0, 0, 0, false};
+    samples = 0;
+    alarmed = 0;
+}
+
+bool CloudOnsetDetector::saveBaseline(double *means, double *variances) const
+{
+    if (learning())
+        return false;
+
+    for (size_t i = 0; i < CLOUD_SEGMENTS; i++)
+    {
+        means[i] = state[i].mean;
+        variances[i] = state[i].variance;
+    }
+    return true;
+}
+
+void CloudOnsetDetector::restoreBaseline(const double *means, const double *variances)
+{
+    reset();
+    for (size_t i = 0; i < CLOUD_SEGMENTS; i++)
+    {
+        if (!std::isfinite(means[i]) || !std::isfinite(variances[i]) || variances[i] < 0)
+        {
+            reset();
+            return;
+        }
+        state[i].mean = means[i];
+        state[i].variance = variances[i];
+    }
+    samples = WARMUP;
+}
+
+bool CloudOnsetDetector::add(const double *segments)
+{
+    for (size_t i = 0; i < CLOUD_SEGMENTS; i++)
+        if (!std::isfinite(segments[i]))
+            return false;
+
+    // Plain mean and variance of the first samples seed the baseline,
+    // variance holds the sum of squares until then
+    if (samples < WARMUP)
+    {
+        samples++;
+        for (size_t i = 0; i < CLOUD_SEGMENTS; i++)
+        {
+            Segment &segment = state[i];
+            double delta = segments[i] - segment.mean;
+            segment.mean += delta / samples;
+            segment.variance += delta * (segments[i] - segment.mean);
+            if (samples == WARMUP)
+                segment.variance /= WARMUP - 1;
+        }
+        return false;
+    }
+
+    bool before = alarm();
+    for (size_t i = 0; i < CLOUD_SEGMENTS; i++)
+    {
+        Segment &segment = state[i];
+        double x = segments[i];
+        double z = (x - segment.mean) / std::max(std::sqrt(segment.variance), MIN_SIGMA);
+        segment.sum = std::min(std::max(segment.sum + z - drift, 0.0), SUM_CAP * threshold);
+
+        if (!segment.alarm && segment.sum >= threshold)
+        {
+            segment.alarm = true;
+            alarmed++;
+        }
+        else if (segment.alarm && segment.sum == 0)
+        {
+            segment.alarm = false;
+            alarmed--;
+        }
+
+        if (segment.alarm)
+            continue;
+
+        double delta = x - segment.mean;
+        segment.mean += weight * delta;
+        segment.variance = (1 - weight) * (segment.variance + weight * delta * delta);
+    }
+
+    return alarm() != before;
+}
+
+double CloudOnsetDetector::score(size_t segment) const
+{
+    if (segment >= CLOUD_SEGMENTS || threshold <= 0)
+        return 0;
+    return state[segment].sum / threshold;
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+    AMSKY01 cloud onset detector
+
+    The cloud cover parameter only moves once the average of the five
+    thermopile segments has warmed across a fixed range. A cloud bank
+    reaches one edge of the field of view first and warms that segment
+    long before the average follows, so each segment is watched on its own
+    for a departure from its clear sky baseline.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstddef>
+
+namespace AMSKY01Protocol
+{
+
+/** @brief Thermopile segments in a cloud sentence. */
+constexpr size_t CLOUD_SEGMENTS = 5;
+
+/**
+ * @brief One-sided CUSUM per thermopile segment.
+ *
+ * Each segment keeps an exponentially weighted mean and variance of its
+ * readings as the baseline. A sample adds z - drift to the segment's sum,
+ * z being its distance above the baseline in standard deviations, and the
+ * sum never drops below zero. Noise keeps the sum near zero, while a
+ * warming sky makes it grow at once, so the alarm trips after a sample or
+ * two for a sharp edge and after a few for a slow one.
+ *
+ * The baseline stops learning while a segment is alarmed, otherwise a
+ * lasting overcast would become the new clear sky. The sum is capped so
+ * the alarm clears soon after the sky returns to the baseline. Memory and
+ * time per sample are constant.
+ */
+class CloudOnsetDetector
+{
+    public:
+        CloudOnsetDetector();
+
+        /** @brief Shift in standard deviations the sum ignores. */
+        void setDrift(double sigmas)
+        {
+            drift = sigmas;
+        }
+
+        /** @brief Sum in standard deviations that trips the alarm. */
+        void setThreshold(double sigmas)
+        {
+            threshold = sigmas;
+        }
+
+        /** @brief Time constant of the baseline in samples. */
+        void setBaselineSamples(double count);
+
+        /** @brief Forget the baseline, e.g. after the sensor was silent. */
+        void reset();
+
+        /**
+         * @brief Copy the baseline out, one value per segment.
+         * @return false while it is still being learnt.
+         */
+        bool saveBaseline(double *means, double *variances) const;
+
+        /** @brief Continue from a saved baseline instead of learning it again. */
+        void restoreBaseline(const double *means, const double *variances);
+
+        /**
+         * @brief Offer the segments of one cloud sentence, in ADU.
+         * @return true when alarm() changed.
+         */
+        bool add(const double *segments);
+
+        /** @brief A segment warmed beyond the threshold and has not cooled back yet. */
+        bool alarm() const
+        {
+            return alarmed > 0;
+        }
+
+        /** @brief The baseline is not known yet, nothing can trip. */
+        bool learning() const
+        {
+            return samples < WARMUP;
+        }
+
+        /** @brief Sum of a segment as a fraction of the threshold, 1 trips. */
+        double score(size_t segment) const;
+
+        double baseline(size_t segment) const
+        {
+            return segment < CLOUD_SEGMENTS ? state[segment].mean : 0;
+        }
+
+    private:
+        // Samples averaged into the first baseline before the sums start
+        static constexpr size_t WARMUP = 20;
+
+        struct Segment
+        {
+            double mean;
+            double variance;
+            double sum;
+            bool alarm;
+        };
+
+        Segment state[CLOUD_SEGMENTS];
+        size_t samples{0};
+        size_t alarmed{0};
+        double drift{1.0};
+        double threshold{8.0};
+        double weight{1.0 / 300};
+};
+
+}
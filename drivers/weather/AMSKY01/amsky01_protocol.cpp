@@ -0,0 +1,282 @@
+/*
+    AMSKY01 serial protocol helpers
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_protocol.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace AMSKY01Protocol
+{
+
+ParseResult parseSentence(const char *line, size_t length, Sentence &out)
+{
+    const char *p = line;
+    const char *end = line + length;
+
+    if (p == end || *p != '$')
+        return (p != end && end[-1] == '#') ? ParseResult::REPLY : ParseResult::NOT_SENTENCE;
+    ++p;
+
+    const char *tagEnd = static_cast<const char *>(memchr(p, ',', static_cast<size_t>(end - p)));
+    if (tagEnd == nullptr)
+        tagEnd = end;
+
+    std::string_view tag(p, static_cast<size_t>(tagEnd - p));
+    uint8_t slot = TAG_TABLE.slot[tagHash(tag)];
+    if (slot == static_cast<uint8_t>(SentenceType::UNKNOWN) || SENTENCES[slot].tag != tag)
+        return ParseResult::UNKNOWN_TAG;
+
+    const SentenceSpec &spec = SENTENCES[slot];
+    out.type = static_cast<SentenceType>(slot);
+    p = tagEnd;
+
+    for (uint8_t i = 0; i < spec.fieldCount; i++)
+    {
+        if (p == end || *p != ',')
+            return ParseResult::MALFORMED;
+        ++p;
+        while (p != end && *p == ' ')
+            ++p;
+
+        std::from_chars_result result = std::from_chars(p, end, out.fields[i]);
+        if (result.ec != std::errc() || (result.ptr != end && *result.ptr != ',' && *result.ptr != ' '))
+            return ParseResult::MALFORMED;
+
+        // Firmware may print counts with a fraction ("120.0"), std::stoi()
+        // used to cut it off
+        if (spec.fields[i] == FieldType::INTEGER)
+        {
+            if (!std::isfinite(out.fields[i]))
+                return ParseResult::MALFORMED;
+            out.fields[i] = std::trunc(out.fields[i]);
+        }
+
+        p = result.ptr;
+        while (p != end && *p == ' ')
+            ++p;
+    }
+
+    spec.derive(out.fields, out.outputs);
+    return ParseResult::OK;
+}
+
+void StreamCounters::count(ParseResult result, SentenceType type)
+{
+    switch (result)
+    {
+        case ParseResult::OK:
+            parsed[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ParseResult::MALFORMED:
+            malformed[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ParseResult::UNKNOWN_TAG:
+            unknownTag.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ParseResult::NOT_SENTENCE:
+            notSentence.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case ParseResult::REPLY:
+            replies.fetch_add(1, std::memory_order_relaxed);
+            break;
+    }
+}
+
+void StreamCounters::reset()
+{
+    for (size_t i = 0; i < SENTENCE_COUNT; i++)
+    {
+        parsed[i].store(0, std::memory_order_relaxed);
+        malformed[i].store(0, std::memory_order_relaxed);
+    }
+    unknownTag.store(0, std::memory_order_relaxed);
+    notSentence.store(0, std::memory_order_relaxed);
+    truncated.store(0, std::memory_order_relaxed);
+    bytesRead.store(0, std::memory_order_relaxed);
+    replies.store(0, std::memory_order_relaxed);
+}
+
+void deriveHygro(const double *fields, double *outputs)
+{
+    outputs[0] = fields[0];
+    outputs[1] = fields[1];
+    outputs[2] = dewPoint(fields[0], fields[1]);
+}
+
+void deriveLight(const double *fields, double *outputs)
+{
+    // Reported lux is ignored, recompute from raw1, gain and integration time
+    double lux = luxFromRaw(fields[1], fields[3], fields[4]);
+    outputs[0] = lux;
+    outputs[1] = skyBrightness(lux);
+}
+
+void deriveCloud(const double *fields, double *outputs)
+{
+    double tempSum = 0.0;
+    for (int i = 0; i < 5; i++)
+    {
+        outputs[2 + i] = fields[i];
+        tempSum += fields[i];
+    }
+    outputs[0] = tempSum / 5.0;
+    outputs[1] = cloudCover(outputs[0]);
+}
+
+double dewPoint(double temperature, double humidity)
+{
+    const double a = 17.27;
+    const double b = 237.7;
+    double alpha = ((a * temperature) / (b + temperature)) + log(humidity / 100.0);
+    return (b * alpha) / (a - alpha);
+}
+
+double luxFromRaw(double raw, double gain, double integrationTime)
+{
+    if (gain <= 0 || integrationTime <= 0)
+        return 0.0;
+
+    return (raw / gain) / integrationTime * 1000000.0;
+}
+
+double skyBrightness(double lux)
+{
+    // Velmi tmavá obloha: ~22 mag/arcsec² při <0.01 lux
+    // Jasná obloha při úplňku: ~19 mag/arcsec² při ~0.1 lux
+    // Městské světlo: ~16-18 mag/arcsec² při >10 lux
+    double sqm = (lux < 0.001) ? 22.0 : 22.0 - 2.5 * log10(lux * 100);
+
+    // Omez na rozumné hodnoty
+    if (sqm < 15.0) sqm = 15.0;
+    if (sqm > 22.5) sqm = 22.5;
+    return sqm;
+}
+
+double cloudCover(double avgSkyTemp)
+{
+    const double minSkyTemp = 64000.0;  // jasná studená obloha
+    const double maxSkyTemp = 66000.0;  // velmi oblačno
+
+    double cover = ((avgSkyTemp - minSkyTemp) / (maxSkyTemp - minSkyTemp)) * 100.0;
+    if (cover < 0.0) cover = 0.0;
+    if (cover > 100.0) cover = 100.0;
+    return cover;
+}
+
+bool FrameAssembler::add(const Sentence &sentence, int64_t timestamp)
+{
+    size_t type = static_cast<size_t>(sentence.type);
+    if (type >= SENTENCE_COUNT)
+        return false;
+
+    const SentenceSpec &spec = SENTENCES[type];
+
+    if (current.updated == 0)
+        current.timestamp = timestamp;
+
+    for (size_t i = 0; i < spec.outputCount; i++)
+        current.values[spec.outputs[i]] = sentence.outputs[i];
+
+    current.updated |= static_cast<uint8_t>(1u << type);
+    return current.updated == COMPLETE;
+}
+
+void FrameAssembler::seed(SentenceType type, const double *outputs)
+{
+    size_t index = static_cast<size_t>(type);
+    if (index >= SENTENCE_COUNT)
+        return;
+
+    const SentenceSpec &spec = SENTENCES[index];
+    for (size_t i = 0; i < spec.outputCount; i++)
+        current.values[spec.outputs[i]] = outputs[i];
+}
+
+const Frame &FrameAssembler::close()
+{
+    closed = current;
+    closed.sequence = nextSequence++;
+    current.updated = 0;
+    return closed;
+}
+
+void FrameAssembler::reset()
+{
+    current = Frame();
+    closed = Frame();
+    nextSequence = 1;
+}
+
+ssize_t LineFramer::readFrom(int fd)
+{
+    size_t freeBytes = space();
+    if (freeBytes == 0)
+        return 0;
+
+    // Free space may wrap around the end of the ring, fill both parts at once
+    size_t start = head & MASK;
+    size_t first = CAPACITY - start;
+    if (first > freeBytes)
+        first = freeBytes;
+
+    struct iovec iov[2];
+    iov[0].iov_base = ring + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = ring;
+    iov[1].iov_len = freeBytes - first;
+
+    ssize_t nbytes = readv(fd, iov, iov[1].iov_len > 0 ? 2 : 1);
+    if (nbytes > 0)
+        head += static_cast<size_t>(nbytes);
+
+    return nbytes;
+}
+
+size_t LineFramer::write(const char *data, size_t len)
+{
+    if (len > space())
+        len = space();
+
+    size_t start = head & MASK;
+    size_t first = CAPACITY - start;
+    if (first > len)
+        first = len;
+
+    memcpy(ring + start, data, first);
+    memcpy(ring, data + first, len - first);
+    head += len;
+
+    return len;
+}
+
+int LineFramer::recent(size_t n, struct iovec iov[2])
+{
+    if (n > pending())
+        n = pending();
+
+    size_t start = (head - n) & MASK;
+    size_t first = CAPACITY - start;
+    if (first > n)
+        first = n;
+
+    iov[0].iov_base = ring + start;
+    iov[0].iov_len = first;
+    iov[1].iov_base = ring;
+    iov[1].iov_len = n - first;
+
+    return iov[1].iov_len > 0 ? 2 : 1;
+}
+
+void LineFramer::reset()
+{
+    head = tail = scan = 0;
+    discarding = false;
+    truncated = 0;
+}
+
+}
@@ -0,0 +1,492 @@
+/*
+    AMSKY01 serial protocol helpers
+
+    Framing and parsing of the continuous $hygro/$light/$cloud stream. Kept
+    free of INDI types so the same code serves the driver, the simulator and
+    tooling.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace AMSKY01Protocol
+{
+
+enum class SentenceType : uint8_t
+{
+    HYGRO,
+    LIGHT,
+    CLOUD,
+    UNKNOWN
+};
+
+constexpr size_t SENTENCE_COUNT = static_cast<size_t>(SentenceType::UNKNOWN);
+
+enum class ParseResult : uint8_t
+{
+    OK,
+    NOT_SENTENCE,   // line does not start with '$'
+    REPLY,          // '#' terminated reply to a command
+    UNKNOWN_TAG,
+    MALFORMED       // missing or unparsable field
+};
+
+/**
+ * @brief Weather parameters published by the driver, in registration order.
+ */
+enum Parameter : uint8_t
+{
+    TEMPERATURE,
+    HUMIDITY,
+    DEW_POINT,
+    LIGHT_LUX,
+    SKY_BRIGHTNESS,
+    CLOUD_COVER,
+    SKY_TEMPERATURE,
+    SKY_TEMP_1,
+    SKY_TEMP_2,
+    SKY_TEMP_3,
+    SKY_TEMP_4,
+    SKY_TEMP_5,
+    PARAMETER_COUNT
+};
+
+struct ParameterSpec
+{
+    const char *name;
+    const char *label;
+    double minOk;
+    double maxOk;
+    double percWarning;
+    bool critical;
+};
+
+inline constexpr ParameterSpec PARAMETERS[PARAMETER_COUNT] =
+{
+    { "WEATHER_TEMPERATURE", "Temperature (°C)", -50, 80, 15, true },
+    { "WEATHER_HUMIDITY", "Humidity (%)", 0, 100, 15, true },
+    { "WEATHER_DEW_POINT", "Dew Point (°C)", -50, 50, 15, true },
+    { "WEATHER_LIGHT_LUX", "Light (lux)", 0, 100000, 15, true },
+    { "WEATHER_SKY_BRIGHTNESS", "Sky Brightness (mag/arcsec²)", 10, 25, 15, true },
+    { "WEATHER_CLOUD_COVER", "Cloud Cover (%)", 0, 100, 15, true },
+    { "WEATHER_SKY_TEMPERATURE", "Sky Temperature Avg (ADU)", 60000, 70000, 15, true },
+    // Individuální teploty ze sky senzoru (5 thermopile segmentů)
+    { "WEATHER_SKY_TEMP_1", "Sky Temp 1 (ADU)", 60000, 70000, 15, false },
+    { "WEATHER_SKY_TEMP_2", "Sky Temp 2 (ADU)", 60000, 70000, 15, false },
+    { "WEATHER_SKY_TEMP_3", "Sky Temp 3 (ADU)", 60000, 70000, 15, false },
+    { "WEATHER_SKY_TEMP_4", "Sky Temp 4 (ADU)", 60000, 70000, 15, false },
+    { "WEATHER_SKY_TEMP_5", "Sky Temp 5 - Zenith (ADU)", 60000, 70000, 15, false },
+};
+
+enum class FieldType : uint8_t
+{
+    REAL,
+    INTEGER
+};
+
+constexpr size_t MAX_FIELDS = 8;
+constexpr size_t MAX_OUTPUTS = 8;
+
+/** @brief Turns the parsed fields of a sentence into its parameter values, in outputs order. */
+typedef void (*DeriveFunction)(const double *fields, double *outputs);
+
+struct SentenceSpec
+{
+    std::string_view tag;
+    const char *sensorName;     // INDI element name of the sensor
+    const char *sensorLabel;
+    uint8_t fieldCount;
+    FieldType fields[MAX_FIELDS];
+    uint8_t outputCount;
+    Parameter outputs[MAX_OUTPUTS];
+    DeriveFunction derive;
+};
+
+void deriveHygro(const double *fields, double *outputs);
+void deriveLight(const double *fields, double *outputs);
+void deriveCloud(const double *fields, double *outputs);
+
+/**
+ * @brief The AMSKY01 sentence schema, indexed by SentenceType.
+ *
+ * Parsing, tag dispatch, parameter registration and publishing are all
+ * generated from this table. Supporting a new firmware sentence means adding
+ * its row here plus its parameters above.
+ */
+inline constexpr SentenceSpec SENTENCES[SENTENCE_COUNT] =
+{
+    // $hygro,temperature,humidity
+    {
+        "hygro", "HYGRO", "Hygro", 2, { FieldType::REAL, FieldType::REAL },
+        3, { TEMPERATURE, HUMIDITY, DEW_POINT },
+        deriveHygro
+    },
+    // $light,lux,raw1,raw2,gain,integration_time_ms
+    {
+        "light", "LIGHT", "Light", 5, { FieldType::REAL, FieldType::INTEGER, FieldType::INTEGER, FieldType::INTEGER, FieldType::INTEGER },
+        2, { LIGHT_LUX, SKY_BRIGHTNESS },
+        deriveLight
+    },
+    // $cloud,temp1,temp2,temp3,temp4,temp5 (4 segmenty + zenit)
+    {
+        "cloud", "CLOUD", "Cloud", 5, { FieldType::REAL, FieldType::REAL, FieldType::REAL, FieldType::REAL, FieldType::REAL },
+        7, { SKY_TEMPERATURE, CLOUD_COVER, SKY_TEMP_1, SKY_TEMP_2, SKY_TEMP_3, SKY_TEMP_4, SKY_TEMP_5 },
+        deriveCloud
+    },
+};
+
+// Tag dispatch: a perfect hash over the schema tags, checked at compile time
+
+constexpr size_t TAG_HASH_SIZE = 8;
+
+constexpr size_t tagHash(std::string_view tag)
+{
+    if (tag.empty())
+        return 0;
+    return (static_cast<uint8_t>(tag.front()) ^ (static_cast<uint8_t>(tag.back()) << 1) ^ tag.size()) & (TAG_HASH_SIZE - 1);
+}
+
+struct TagTable
+{
+    uint8_t slot[TAG_HASH_SIZE];
+    bool perfect;
+};
+
+constexpr TagTable buildTagTable()
+{
+    TagTable table { {}, true };
+    for (size_t i = 0; i < TAG_HASH_SIZE; i++)
+        table.slot[i] = static_cast<uint8_t>(SentenceType::UNKNOWN);
+
+    for (size_t i = 0; i < SENTENCE_COUNT; i++)
+    {
+        size_t h = tagHash(SENTENCES[i].tag);
+        if (table.slot[h] != static_cast<uint8_t>(SentenceType::UNKNOWN))
+            table.perfect = false;
+        table.slot[h] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+inline constexpr TagTable TAG_TABLE = buildTagTable();
+static_assert(TAG_TABLE.perfect, "sentence tags collide in tagHash, adjust the hash");
+
+constexpr bool schemaIsConsistent()
+{
+    bool seen[PARAMETER_COUNT] = {};
+    for (const SentenceSpec &sentence : SENTENCES)
+    {
+        if (sentence.fieldCount > MAX_FIELDS || sentence.outputCount > MAX_OUTPUTS)
+            return false;
+        for (size_t i = 0; i < sentence.outputCount; i++)
+        {
+            if (seen[sentence.outputs[i]])
+                return false;
+            seen[sentence.outputs[i]] = true;
+        }
+    }
+    for (bool fed : seen)
+        if (!fed)
+            return false;
+    return true;
+}
+
+static_assert(schemaIsConsistent(), "every parameter must be fed by exactly one sentence");
+
+/**
+ * @brief One parsed sentence: raw fields in wire order and derived parameter values.
+ *
+ * Integer fields (raw counts, gain, integration time) are stored as exact
+ * doubles so every sentence shares the same fixed layout.
+ */
+struct Sentence
+{
+    SentenceType type = SentenceType::UNKNOWN;
+    int64_t received = 0;   // monotonic time the bytes were read, see monotonicNs()
+    int64_t parsed = 0;     // monotonic time parsing finished
+    double fields[MAX_FIELDS] = {0};
+    double outputs[MAX_OUTPUTS] = {0};
+};
+
+/** @brief Monotonic clock in nanoseconds, used for every receive timestamp. */
+inline int64_t monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Parse one line in place and derive its parameter values.
+ *
+ * Single pass, no heap allocation, no exceptions and independent of the
+ * current locale. Fields beyond the ones in the schema are ignored.
+ */
+ParseResult parseSentence(const char *line, size_t length, Sentence &out);
+
+/**
+ * @brief Outcome of every line and byte of the stream, for diagnostics.
+ *
+ * Each counter has a single writer, the thread that reads and parses, so
+ * relaxed atomics are enough and another thread may read them at any time.
+ * Unknown tags, replies and lines without '$' have no sentence type.
+ */
+struct StreamCounters
+{
+    std::atomic<uint64_t> parsed[SENTENCE_COUNT];
+    std::atomic<uint64_t> malformed[SENTENCE_COUNT];
+    std::atomic<uint64_t> unknownTag;
+    std::atomic<uint64_t> notSentence;
+    std::atomic<uint64_t> truncated;    // overlong lines dropped by LineFramer
+    std::atomic<uint64_t> bytesRead;
+    std::atomic<uint64_t> replies;      // command replies split off the stream
+
+    StreamCounters()
+    {
+        reset();
+    }
+
+    void count(ParseResult result, SentenceType type);
+    void reset();
+};
+
+// Derived quantities, shared by every consumer of the stream
+
+/** @brief Dew point (°C) using the Magnus formula. */
+double dewPoint(double temperature, double humidity);
+
+/** @brief Illuminance from raw counts normalised by gain and integration time (ms). */
+double luxFromRaw(double raw, double gain, double integrationTime);
+
+/** @brief Approximate sky brightness (mag/arcsec²) from lux, limited to 15-22.5. */
+double skyBrightness(double lux);
+
+/** @brief Cloud cover (%) from the average thermopile reading (ADU). */
+double cloudCover(double avgSkyTemp);
+
+/**
+ * @brief One coherent snapshot of every weather parameter.
+ */
+struct Frame
+{
+    uint64_t sequence = 0;
+    int64_t timestamp = 0;                  // wall clock of the first sentence, ns since epoch
+    uint8_t updated = 0;                    // bit per SentenceType refreshed in this frame
+    double values[PARAMETER_COUNT] = {0};   // latest value of every parameter
+};
+
+/**
+ * @brief Collects hygro, light and cloud sentences into frames.
+ *
+ * A frame is complete once every sentence type has arrived. The caller closes
+ * it then, or earlier when its own deadline expires. Values of sentences that
+ * did not arrive carry over from the previous frame.
+ */
+class FrameAssembler
+{
+    public:
+        static constexpr uint8_t COMPLETE = (1u << SENTENCE_COUNT) - 1;
+
+        /** @return true when the current frame now holds every sentence type. */
+        bool add(const Sentence &sentence, int64_t timestamp);
+
+        /**
+         * @brief Carry values over without a sentence having arrived, e.g.
+         * restored ones. The sentence type is not marked as updated.
+         */
+        void seed(SentenceType type, const double *outputs);
+
+        /** @brief Finish the current frame and return it with its sequence number. */
+        const Frame &close();
+
+        bool pending() const
+        {
+            return current.updated != 0;
+        }
+        const Frame &frame() const
+        {
+            return current;
+        }
+
+        void reset();
+
+    private:
+        Frame current;
+        Frame closed;
+        uint64_t nextSequence = 1;
+};
+
+/**
+ * @brief Persistent ring buffer that turns the raw byte stream into lines.
+ *
+ * Every wakeup reads all bytes the kernel has with a single readv() and then
+ * hands out every complete line. A partial line stays in the ring until the
+ * rest arrives, so a fast device can never build up a backlog in the tty.
+ * Lines longer than MAX_LINE are dropped up to the next newline. A command
+ * reply, anything not starting with '$' up to a '#', is handed out as its
+ * own line including the '#'. Empty lines are skipped.
+ */
+class LineFramer
+{
+    public:
+        static constexpr size_t CAPACITY = 8192;    // must be a power of two
+        static constexpr size_t MAX_LINE = 1024;    // longest accepted line
+
+        /**
+         * @brief Read everything available on fd into the ring.
+         * @return bytes read, 0 on EOF, -1 on error (errno is preserved).
+         */
+        ssize_t readFrom(int fd);
+
+        /**
+         * @brief Append bytes that did not come from a file descriptor.
+         * @return number of bytes stored, less than len when the ring is full.
+         */
+        size_t write(const char *data, size_t len);
+
+        /**
+         * @brief Call onLine(const char *line, size_t length) for every complete line.
+         *
+         * The line is NUL terminated, stripped of "\r\n" and only valid during
+         * the call.
+         * @return number of lines delivered.
+         */
+        template <typename Handler>
+        size_t drain(Handler &&onLine);
+
+        /**
+         * @brief The last n bytes stored, as they came from the wire.
+         *
+         * Only valid before drain(), which terminates lines in place.
+         * @return number of spans filled, the bytes may wrap around the ring.
+         */
+        int recent(size_t n, struct iovec iov[2]);
+
+        void reset();
+
+        size_t pending() const
+        {
+            return head - tail;
+        }
+        size_t space() const
+        {
+            return CAPACITY - (head - tail);
+        }
+        uint64_t truncatedLines() const
+        {
+            return truncated;
+        }
+
+    private:
+        static constexpr size_t MASK = CAPACITY - 1;
+        static_assert((CAPACITY & MASK) == 0, "CAPACITY must be a power of two");
+        static_assert(CAPACITY >= 2 * MAX_LINE, "ring must hold a full line plus a read");
+
+        char ring[CAPACITY];
+        char line[MAX_LINE + 1];
+
+        // Monotonic positions, masked on access
+        size_t head = 0;    // next byte to write
+        size_t tail = 0;    // start of the current (partial) line
+        size_t scan = 0;    // first byte not yet searched for '\n'
+
+        bool discarding = false;    // skipping the rest of an overlong line
+        uint64_t truncated = 0;
+};
+
+template <typename Handler>
+size_t LineFramer::drain(Handler &&onLine)
+{
+    size_t lines = 0;
+
+    while (scan != head)
+    {
+        size_t pos = scan & MASK;
+        size_t contiguous = head - scan;
+        if (contiguous > CAPACITY - pos)
+            contiguous = CAPACITY - pos;
+
+        const char *nl = static_cast<const char *>(memchr(ring + pos, '\n', contiguous));
+
+        // Command replies are not '$' sentences and end with '#', often
+        // without a newline, so they are split off the stream right there
+        const char *hash = nullptr;
+        if (!discarding && ring[tail & MASK] != '$')
+        {
+            size_t limit = nl ? static_cast<size_t>(nl - (ring + pos)) : contiguous;
+            hash = static_cast<const char *>(memchr(ring + pos, '#', limit));
+        }
+
+        if (nl == nullptr && hash == nullptr)
+        {
+            scan += contiguous;
+            continue;
+        }
+
+        // A reply keeps its '#', a line loses its '\n'
+        size_t end = scan + static_cast<size_t>((hash ? hash : nl) - (ring + pos));
+        size_t length = end - tail + (hash ? 1 : 0);
+        scan = end + 1;
+
+        if (discarding || length > MAX_LINE)
+        {
+            if (!discarding)
+                truncated++;
+            discarding = false;
+            tail = scan;
+            continue;
+        }
+
+        size_t start = tail & MASK;
+        char *text;
+        if (hash == nullptr && start + length < CAPACITY)
+        {
+            // Contiguous in the ring, terminate in place of the '\n'
+            text = ring + start;
+        }
+        else
+        {
+            // Wrapped line, or a reply that must not be terminated in place
+            size_t first = CAPACITY - start;
+            if (first > length)
+                first = length;
+            memcpy(line, ring + start, first);
+            memcpy(line + first, ring, length - first);
+            text = line;
+        }
+        text[length] = '\0';
+
+        if (length > 0 && text[length - 1] == '\r')
+            text[--length] = '\0';
+
+        tail = scan;
+        if (length == 0)
+            continue;
+
+        onLine(static_cast<const char *>(text), length);
+        lines++;
+    }
+
+    // Overlong partial line, drop it now so the ring never fills up
+    if (head - tail > MAX_LINE)
+    {
+        if (!discarding)
+            truncated++;
+        discarding = true;
+        tail = head;
+    }
+
+    return lines;
+}
+
+}
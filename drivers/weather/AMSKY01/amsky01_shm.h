@@ -0,0 +1,168 @@
+/*
+    AMSKY01 shared-memory snapshot
+
+    indi_amsky01 can publish its latest weather frame into a POSIX
+    shared-memory segment (SHM_SNAPSHOT switch, segment name in SHM_NAME,
+    "/amsky01" by default). Local processes read it with this header, in C
+    or C++, without an INDI client:
+
+        const struct amsky01_shm *shm = amsky01_shm_open("/amsky01");
+        struct amsky01_shm_snapshot snapshot;
+        if (shm && amsky01_shm_read(shm, &snapshot) == 0)
+            printf("cloud cover %.0f %%\n", snapshot.values[AMSKY01_SHM_CLOUD_COVER]);
+        amsky01_shm_close(shm);
+
+    The segment is guarded by a seqlock: the driver never waits for readers
+    and a read retries until it got a snapshot that was not being written.
+    Older glibc needs -lrt for shm_open.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#ifndef AMSKY01_SHM_H
+#define AMSKY01_SHM_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define AMSKY01_SHM_DEFAULT_NAME "/amsky01"
+#define AMSKY01_SHM_MAGIC 0x4b534d41u   /* "AMSK" */
+#define AMSKY01_SHM_VERSION 1u
+
+/* Index into amsky01_shm_snapshot.values, same order as the INDI parameters */
+enum amsky01_shm_parameter
+{
+    AMSKY01_SHM_TEMPERATURE,        /* °C */
+    AMSKY01_SHM_HUMIDITY,           /* % */
+    AMSKY01_SHM_DEW_POINT,          /* °C */
+    AMSKY01_SHM_LIGHT_LUX,          /* lux */
+    AMSKY01_SHM_SKY_BRIGHTNESS,     /* mag/arcsec² */
+    AMSKY01_SHM_CLOUD_COVER,        /* % */
+    AMSKY01_SHM_SKY_TEMPERATURE,    /* ADU, average of the segments */
+    AMSKY01_SHM_SKY_TEMP_1,         /* ADU */
+    AMSKY01_SHM_SKY_TEMP_2,
+    AMSKY01_SHM_SKY_TEMP_3,
+    AMSKY01_SHM_SKY_TEMP_4,
+    AMSKY01_SHM_SKY_TEMP_5,         /* ADU, zenith */
+    AMSKY01_SHM_PARAMETER_COUNT
+};
+
+/* Bits of amsky01_shm_snapshot.updated and .stale */
+enum amsky01_shm_sensor
+{
+    AMSKY01_SHM_SENSOR_HYGRO = 1u << 0,
+    AMSKY01_SHM_SENSOR_LIGHT = 1u << 1,
+    AMSKY01_SHM_SENSOR_CLOUD = 1u << 2
+};
+
+/* Values of amsky01_shm_snapshot.state, as INDI IPState */
+enum amsky01_shm_state
+{
+    AMSKY01_SHM_STATE_IDLE,
+    AMSKY01_SHM_STATE_OK,
+    AMSKY01_SHM_STATE_WARNING,
+    AMSKY01_SHM_STATE_ALERT
+};
+
+struct amsky01_shm_snapshot
+{
+    uint64_t sequence;      /* frame sequence number, 0 until the first frame */
+    int64_t timestamp_ns;   /* wall clock of the frame, ns since the epoch */
+    uint32_t updated;       /* sensors refreshed in this frame */
+    uint32_t stale;         /* sensors that stopped reporting, their values are old */
+    int32_t state;          /* overall weather state of the critical parameters */
+    uint32_t reserved;
+    double values[AMSKY01_SHM_PARAMETER_COUNT];
+};
+
+#define AMSKY01_SHM_SNAPSHOT_WORDS (sizeof(struct amsky01_shm_snapshot) / sizeof(uint64_t))
+
+#ifdef __cplusplus
+static_assert(sizeof(struct amsky01_shm_snapshot) % sizeof(uint64_t) == 0, "snapshot must be whole words");
+#else
+_Static_assert(sizeof(struct amsky01_shm_snapshot) % sizeof(uint64_t) == 0, "snapshot must be whole words");
+#endif
+
+struct amsky01_shm
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;          /* sizeof(struct amsky01_shm) */
+    uint32_t seq;           /* seqlock, odd while the driver is writing */
+    uint64_t data[AMSKY01_SHM_SNAPSHOT_WORDS];
+};
+
+/* Map a segment for reading. Returns NULL if it does not exist or does not match this header. */
+static inline const struct amsky01_shm *amsky01_shm_open(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    void *map = mmap(NULL, sizeof(struct amsky01_shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const struct amsky01_shm *shm = (const struct amsky01_shm *)map;
+    if (shm->magic != AMSKY01_SHM_MAGIC || shm->version != AMSKY01_SHM_VERSION ||
+            shm->size != sizeof(struct amsky01_shm))
+    {
+        munmap(map, sizeof(struct amsky01_shm));
+        return NULL;
+    }
+    return shm;
+}
+
+static inline void amsky01_shm_close(const struct amsky01_shm *shm)
+{
+    if (shm != NULL)
+        munmap((void *)shm, sizeof(struct amsky01_shm));
+}
+
+/* Copy a consistent snapshot. Returns 0 on success, -1 before the first frame. */
+static inline int amsky01_shm_read(const struct amsky01_shm *shm, struct amsky01_shm_snapshot *out)
+{
+    uint64_t words[AMSKY01_SHM_SNAPSHOT_WORDS];
+    uint32_t before, after;
+    size_t i;
+
+    do
+    {
+        before = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+        if (before & 1)
+            continue;
+
+        for (i = 0; i < AMSKY01_SHM_SNAPSHOT_WORDS; i++)
+            words[i] = __atomic_load_n(&shm->data[i], __ATOMIC_RELAXED);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED);
+    }
+    while ((before & 1) || before != after);
+
+    memcpy(out, words, sizeof(*out));
+    return out->sequence == 0 ? -1 : 0;
+}
+
+/* Writer side, used by the driver. Only one writer may exist. */
+static inline void amsky01_shm_store(struct amsky01_shm *shm, const struct amsky01_shm_snapshot *in)
+{
+    uint64_t words[AMSKY01_SHM_SNAPSHOT_WORDS];
+    uint32_t seq = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED);
+    size_t i;
+
+    memcpy(words, in, sizeof(*in));
+
+    __atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (i = 0; i < AMSKY01_SHM_SNAPSHOT_WORDS; i++)
+        __atomic_store_n(&shm->data[i], words[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,238 @@
+/*
+    AMSKY01 stream simulator
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_simulator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace AMSKY01Protocol
+{
+
+namespace
+{
+// Generator wakeups, lines due in between are written as one batch
+constexpr std::chrono::milliseconds TICK(10);
+
+// Mean time between dropouts of one sensor and their length, seconds
+constexpr double DROPOUT_INTERVAL = 60;
+constexpr double DROPOUT_MIN = 5;
+constexpr double DROPOUT_MAX = 45;
+
+// Clear and overcast thermopile readings, see cloudCover()
+constexpr double CLEAR_SKY_ADU = 64300;
+constexpr double OVERCAST_ADU = 65800;
+
+// Segment offsets from the average, the zenith segment is the coldest
+constexpr double SEGMENT_OFFSET[5] = { 30, 60, -10, 10, -90 };
+}
+
+Simulator::~Simulator()
+{
+    stop();
+}
+
+bool Simulator::start()
+{
+    if (running)
+        return true;
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+        return false;
+
+    readFD = fds[0];
+    writeFD = fds[1];
+    pending.clear();
+    lost = 0;
+    for (double &until : silentUntil)
+        until = 0;
+
+    running = true;
+    thread = std::thread(&Simulator::run, this);
+    return true;
+}
+
+void Simulator::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+
+    if (writeFD >= 0)
+        close(writeFD);
+    if (readFD >= 0)
+        close(readFD);
+    readFD = writeFD = -1;
+}
+
+void Simulator::setScenario(Scenario value)
+{
+    scenario = value;
+}
+
+void Simulator::setRate(double linesPerSecond)
+{
+    rate = std::fmin(std::fmax(linesPerSecond, MIN_RATE), MAX_RATE);
+}
+
+void Simulator::setPeriod(double seconds)
+{
+    period = std::fmax(seconds, 1.0);
+}
+
+double Simulator::progress(double t) const
+{
+    double length = period.load(std::memory_order_relaxed);
+    double cycle = std::fmod(t, 2 * length) / length;
+    return cycle <= 1 ? cycle : 2 - cycle;
+}
+
+size_t Simulator::generate(SentenceType type, double t, char *buffer, size_t size)
+{
+    size_t index = static_cast<size_t>(type);
+    if (index >= SENTENCE_COUNT || t < silentUntil[index])
+        return 0;
+
+    std::normal_distribution<double> noise(0.0, 1.0);
+    int active = scenario.load(std::memory_order_relaxed);
+    double p = progress(t);
+    int length = 0;
+
+    switch (type)
+    {
+        case SentenceType::HYGRO:
+        {
+            double temperature = 10.0, humidity = 65.0;
+            if (active == DEW)
+            {
+                temperature -= 6.0 * p;
+                humidity += 35.0 * p;
+            }
+            else if (active == CLOUDING)
+            {
+                // Clouds stop the radiative cooling
+                temperature += 2.0 * p;
+            }
+            temperature += 0.05 * noise(random);
+            humidity = std::fmin(humidity + 0.2 * noise(random), 100.0);
+            length = snprintf(buffer, size, "$hygro,%.2f,%.2f\r\n", temperature, humidity);
+            break;
+        }
+
+        case SentenceType::LIGHT:
+        {
+            // Sun altitude in degrees, only twilight moves it above the night floor
+            double altitude = (active == TWILIGHT) ? 2.0 - 20.0 * p : -30.0;
+            double lux = std::pow(10.0, std::fmax(2.6 + 0.35 * altitude, -3.5));
+            lux *= 1.0 + 0.01 * noise(random);
+
+            // Firmware auto-range: most sensitive setting that does not saturate
+            static constexpr int GAINS[] = { 9876, 428, 25, 1 };
+            int gain = 1, integration = 100;
+            for (int g : GAINS)
+            {
+                if (lux * g * 600 / 1e6 <= 60000)
+                {
+                    gain = g;
+                    integration = 600;
+                    break;
+                }
+            }
+            long raw1 = std::lround(lux * gain * integration / 1e6);
+            long raw2 = std::lround(raw1 * 0.4);
+            length = snprintf(buffer, size, "$light,%.4f,%ld,%ld,%d,%d\r\n", lux, raw1, raw2, gain, integration);
+            break;
+        }
+
+        case SentenceType::CLOUD:
+        {
+            double sky = CLEAR_SKY_ADU;
+            if (active == CLOUDING)
+                sky += (OVERCAST_ADU - CLEAR_SKY_ADU) * p;
+
+            double segment[5];
+            for (int i = 0; i < 5; i++)
+                segment[i] = sky + SEGMENT_OFFSET[i] + 5.0 * noise(random);
+            length = snprintf(buffer, size, "$cloud,%.2f,%.2f,%.2f,%.2f,%.2f\r\n",
+                              segment[0], segment[1], segment[2], segment[3], segment[4]);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    if (length <= 0 || static_cast<size_t>(length) >= size)
+        return 0;
+    return static_cast<size_t>(length);
+}
+
+void Simulator::run()
+{
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point begin = Clock::now();
+    Clock::time_point next = begin;
+    Clock::time_point last = begin;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double due = 0;
+    size_t sensor = 0;
+    char line[256];
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        next += TICK;
+        std::this_thread::sleep_until(next);
+
+        Clock::time_point now = Clock::now();
+        double dt = std::chrono::duration<double>(now - last).count();
+        double t = std::chrono::duration<double>(now - begin).count();
+        last = now;
+
+        // Never try to catch up more than a tenth of a second after a stall
+        double linesPerSecond = rate.load(std::memory_order_relaxed);
+        due = std::fmin(due + linesPerSecond * dt, linesPerSecond * 0.1 + 1);
+        size_t lines = static_cast<size_t>(due);
+        due -= lines;
+
+        // Dropouts start at random and last until silentUntil
+        for (double &until : silentUntil)
+        {
+            if (scenario.load(std::memory_order_relaxed) != DROPOUTS)
+                until = 0;
+            else if (t >= until && uniform(random) < dt / DROPOUT_INTERVAL)
+                until = t + DROPOUT_MIN + (DROPOUT_MAX - DROPOUT_MIN) * uniform(random);
+        }
+
+        // The reader is behind, new lines are lost like in a full FIFO
+        if (!pending.empty())
+        {
+            lost.fetch_add(lines, std::memory_order_relaxed);
+            lines = 0;
+        }
+
+        for (size_t i = 0; i < lines; i++)
+        {
+            SentenceType type = static_cast<SentenceType>(sensor++ % SENTENCE_COUNT);
+            size_t length = generate(type, t, line, sizeof(line));
+            pending.append(line, length);
+        }
+
+        if (pending.empty())
+            continue;
+
+        ssize_t written = write(writeFD, pending.data(), pending.size());
+        if (written > 0)
+            pending.erase(0, static_cast<size_t>(written));
+    }
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+    AMSKY01 stream simulator
+
+    Generates the $hygro/$light/$cloud stream of a real sensor following a
+    night scenario and writes it into a pipe, so simulation exercises the
+    same framing, parsing and publishing path as hardware.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include "amsky01_protocol.h"
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace AMSKY01Protocol
+{
+
+/**
+ * @brief Scenario driven line generator running on its own thread.
+ *
+ * Lines rotate through hygro, light and cloud at a configurable rate. The
+ * scenario shapes the values over a repeating period: it runs forward for one
+ * period and back for the next, so every transition is seen in both
+ * directions. When the pipe is full the generator behaves like a UART with a
+ * full FIFO: lines are lost and counted as overruns.
+ */
+class Simulator
+{
+    public:
+        enum Scenario
+        {
+            CLEAR,      // steady clear night
+            CLOUDING,   // clear to overcast
+            DEW,        // temperature falls onto the dew point
+            TWILIGHT,   // sun from the horizon to astronomical night
+            DROPOUTS,   // clear night with sensors going silent at random
+            SCENARIO_COUNT
+        };
+
+        static constexpr double MIN_RATE = 1;
+        static constexpr double MAX_RATE = 10000;
+
+        ~Simulator();
+
+        /**
+         * @brief Create the pipe and start generating.
+         * @return false with errno set when the pipe cannot be created.
+         */
+        bool start();
+
+        /** @brief Stop the generator and close the pipe. */
+        void stop();
+
+        /** @brief Read end of the pipe, -1 when stopped. */
+        int fd() const
+        {
+            return readFD;
+        }
+
+        void setScenario(Scenario value);
+        void setRate(double linesPerSecond);
+        void setPeriod(double seconds);
+
+        /** @brief Lines lost because the reader did not keep up. */
+        uint64_t overruns() const
+        {
+            return lost.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Format the line of the given sensor at scenario time t (s).
+         * @return line length including the trailing "\r\n", 0 if the sensor is silent.
+         */
+        size_t generate(SentenceType type, double t, char *buffer, size_t size);
+
+    private:
+        void run();
+        double progress(double t) const;
+
+        std::thread thread;
+        std::atomic<bool> running{false};
+        int readFD{-1};
+        int writeFD{-1};
+
+        std::atomic<int> scenario{CLEAR};
+        std::atomic<double> rate{10};
+        std::atomic<double> period{600};
+        std::atomic<uint64_t> lost{0};
+
+        // Generator thread only
+        std::mt19937 random{20250101};
+        double silentUntil[SENTENCE_COUNT] = {0};
+        std::string pending;    // formatted lines the pipe did not take yet
+};
+
+}
@@ -0,0 +1,93 @@
+/*
+    Single-producer/single-consumer ring buffer
+
+    Wait-free queue used to hand fixed-size samples from the AMSKY01 reader
+    thread to the INDI main thread.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Bounded wait-free queue for exactly one producer and one consumer thread.
+ *
+ * push() never blocks, it fails when the queue is full and the caller decides
+ * what to do with the item. Each side keeps a cached copy of the other side's
+ * index so the shared cache line is only touched when the queue looks full or
+ * empty.
+ */
+template <typename T, size_t N>
+class SpscQueue
+{
+    public:
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+        /** @brief Producer side. @return false if the queue is full. */
+        bool push(const T &item)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - cachedTail == N)
+            {
+                cachedTail = tail.load(std::memory_order_acquire);
+                if (h - cachedTail == N)
+                    return false;
+            }
+
+            slots[h & (N - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** @brief Consumer side. @return false if the queue is empty. */
+        bool pop(T &item)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == cachedHead)
+            {
+                cachedHead = head.load(std::memory_order_acquire);
+                if (t == cachedHead)
+                    return false;
+            }
+
+            item = slots[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** @brief Approximate number of queued items, safe from either side. */
+        size_t size() const
+        {
+            size_t t = tail.load(std::memory_order_acquire);
+            size_t h = head.load(std::memory_order_acquire);
+            return h - t;
+        }
+
+        static constexpr size_t capacity()
+        {
+            return N;
+        }
+
+        /** @brief Drop everything. Only call while neither side is running. */
+        void clear()
+        {
+            head.store(0, std::memory_order_relaxed);
+            tail.store(0, std::memory_order_relaxed);
+            cachedHead = cachedTail = 0;
+        }
+
+    private:
+        // Producer owned
+        alignas(64) std::atomic<size_t> head{0};
+        size_t cachedTail = 0;
+
+        // Consumer owned
+        alignas(64) std::atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+
+        alignas(64) T slots[N];
+};
@@ -0,0 +1,77 @@
+/*
+    AMSKY01 warm start state
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_state.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace AMSKY01Protocol
+{
+
+bool saveWarmState(const std::string &path, WarmState &state)
+{
+    memcpy(state.magic, WARM_STATE_MAGIC, sizeof(state.magic));
+    state.version = WARM_STATE_VERSION;
+    state.size = sizeof(WarmState);
+
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    ssize_t written = ::write(fd, &state, sizeof(state));
+    int writeError = errno;
+    ::close(fd);
+    if (written != static_cast<ssize_t>(sizeof(state)))
+    {
+        unlink(temporary.c_str());
+        errno = written < 0 ? writeError : ENOSPC;
+        return false;
+    }
+
+    // No fsync, the file is rewritten every few seconds from the event loop;
+    // after a power cut the loader rejects a short file and the driver
+    // starts cold
+    if (rename(temporary.c_str(), path.c_str()) < 0)
+    {
+        int renameError = errno;
+        unlink(temporary.c_str());
+        errno = renameError;
+        return false;
+    }
+    return true;
+}
+
+bool loadWarmState(const std::string &path, WarmState &state)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ssize_t length = ::read(fd, &state, sizeof(state));
+    int readError = errno;
+    ::close(fd);
+    if (length < 0)
+    {
+        errno = readError;
+        return false;
+    }
+
+    if (length != static_cast<ssize_t>(sizeof(state)) || memcmp(state.magic, WARM_STATE_MAGIC, sizeof(state.magic)) != 0 ||
+            state.version != WARM_STATE_VERSION || state.size != sizeof(WarmState))
+    {
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+    AMSKY01 warm start state
+
+    The last sentence of every sensor, the cloud onset baseline and the
+    night quantiles, kept in a small file so a restarted driver can show
+    the last known weather at once instead of zeros until the firmware has
+    sent every sentence type again.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include "amsky01_protocol.h"
+#include "amsky01_onset.h"
+#include "amsky01_stats.h"
+
+#include <cstdint>
+#include <string>
+
+namespace AMSKY01Protocol
+{
+
+constexpr char WARM_STATE_MAGIC[8] = { 'A', 'M', 'S', 'K', 'Y', 'W', 'S', 'T' };
+constexpr uint32_t WARM_STATE_VERSION = 2;
+
+/** @brief Night quantile estimators kept, parameters times quantiles. */
+constexpr size_t WARM_NIGHT_QUANTILES = 6;
+
+/** @brief File contents, native byte order; size guards against layout changes. */
+struct WarmState
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+    int64_t saved;                          // UTC ns
+    int64_t received[SENTENCE_COUNT];       // UTC ns of each sensor's last sentence, 0 = none
+    double fields[SENTENCE_COUNT][MAX_FIELDS];
+    double outputs[SENTENCE_COUNT][MAX_OUTPUTS];
+    uint32_t onsetValid;                    // the baseline below was learnt
+    uint32_t reserved;
+    double onsetMean[CLOUD_SEGMENTS];
+    double onsetVariance[CLOUD_SEGMENTS];
+    int64_t nightStart;                     // UTC ns of the first sample of the night, 0 = none
+    P2QuantileState night[WARM_NIGHT_QUANTILES];
+};
+
+/**
+ * @brief Replace the file with state.
+ *
+ * Written to a temporary file next to it and renamed over it, so a reader
+ * or a crash never sees half a state.
+ * @return false with errno set.
+ */
+bool saveWarmState(const std::string &path, WarmState &state);
+
+/** @return false with errno set when the file is missing or not a state of this version. */
+bool loadWarmState(const std::string &path, WarmState &state);
+
+}
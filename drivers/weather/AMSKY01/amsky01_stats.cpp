@@ -0,0 +1,417 @@
+/*
+    Streaming statistics for the weather drivers
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void IntervalStats::add(double interval)
+{
+    if (filled == WINDOW)
+    {
+        sum -= intervals[next];
+        sumSq -= intervals[next] * intervals[next];
+    }
+    else
+        filled++;
+
+    intervals[next] = interval;
+    sum += interval;
+    sumSq += interval * interval;
+    next = (next + 1) % WINDOW;
+}
+
+void IntervalStats::reset()
+{
+    next = filled = 0;
+    sum = sumSq = 0;
+}
+
+double IntervalStats::mean() const
+{
+    return filled > 0 ? sum / filled : 0.0;
+}
+
+double IntervalStats::stddev() const
+{
+    if (filled < 2)
+        return 0.0;
+
+    double m = mean();
+    double variance = sumSq / filled - m * m;
+    return variance > 0 ? std::sqrt(variance) : 0.0;
+}
+
+double IntervalStats::max() const
+{
+    double result = 0;
+    for (size_t i = 0; i < filled; i++)
+        if (intervals[i] > result)
+            result = intervals[i];
+    return result;
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return static_cast<size_t>(value);
+
+    // Octave from the highest set bit, sub-bucket from the next two bits
+    int msb = 63 - __builtin_clzll(value);
+    size_t sub = static_cast<size_t>(value >> (msb - 2)) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>(msb) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    int msb = static_cast<int>(bucket / SUB_BUCKETS);
+    uint64_t sub = bucket % SUB_BUCKETS;
+    uint64_t base = (static_cast<uint64_t>(SUB_BUCKETS) + sub) << (msb - 2);
+    return base + (1ull << (msb - 2)) - 1;
+}
+
+void LatencyHistogram::record(int64_t nanoseconds)
+{
+    if (nanoseconds < 0)
+        nanoseconds = 0;
+
+    buckets[bucketOf(static_cast<uint64_t>(nanoseconds))]++;
+    total++;
+    if (nanoseconds > maximum)
+        maximum = nanoseconds;
+}
+
+void LatencyHistogram::reset()
+{
+    for (uint64_t &bucket : buckets)
+        bucket = 0;
+    total = 0;
+    maximum = 0;
+}
+
+int64_t LatencyHistogram::percentile(double quantile) const
+{
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * total));
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            // Never report more than was actually observed
+            int64_t bound = static_cast<int64_t>(bucketUpperBound(i));
+            return bound < maximum ? bound : maximum;
+        }
+    }
+
+    return maximum;
+}
+
+void WindowStats::setWindow(double seconds)
+{
+    seconds = std::max(seconds, 1.0);
+    bucketWidth = std::max(1.0, std::ceil(seconds / MAX_BUCKETS));
+    ring.assign(static_cast<size_t>(std::ceil(seconds / bucketWidth)), Bucket());
+    reset();
+}
+
+void WindowStats::reset()
+{
+    for (Bucket &bucket : ring)
+        bucket = Bucket();
+    current = -1;
+    total = Bucket();
+    minima.clear();
+    maxima.clear();
+}
+
+void WindowStats::add(double value, double now)
+{
+    if (ring.empty())
+        setWindow(60);
+
+    advance(static_cast<int64_t>(std::floor(now / bucketWidth)));
+
+    if (total.count == 0)
+        offset = value;
+    double shifted = value - offset;
+
+    Bucket &bucket = ring[current % ring.size()];
+    if (bucket.count == 0)
+        bucket.min = bucket.max = value;
+    else
+    {
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+    }
+    bucket.count++;
+    bucket.sum += shifted;
+    bucket.sumSq += shifted * shifted;
+
+    total.count++;
+    total.sum += shifted;
+    total.sumSq += shifted * shifted;
+}
+
+void WindowStats::expire(double now)
+{
+    if (!ring.empty() && current >= 0)
+        advance(static_cast<int64_t>(std::floor(now / bucketWidth)));
+}
+
+void WindowStats::advance(int64_t index)
+{
+    if (index <= current)
+        return;
+
+    int64_t size = static_cast<int64_t>(ring.size());
+    if (current < 0 || index - current >= size)
+    {
+        // Everything left the window
+        reset();
+        current = index;
+        ring[current % size].index = current;
+        return;
+    }
+
+    close(ring[current % size]);
+
+    // Reuse the slots of the buckets that left the window
+    while (current < index)
+    {
+        current++;
+        Bucket &bucket = ring[current % size];
+        if (bucket.index >= 0)
+        {
+            total.count -= bucket.count;
+            total.sum -= bucket.sum;
+            total.sumSq -= bucket.sumSq;
+        }
+        bucket = Bucket();
+        bucket.index = current;
+    }
+
+    int64_t oldest = current - size + 1;
+    while (!minima.empty() && minima.front().index < oldest)
+        minima.pop_front();
+    while (!maxima.empty() && maxima.front().index < oldest)
+        maxima.pop_front();
+
+    if (total.count == 0)
+        total.sum = total.sumSq = 0;
+}
+
+void WindowStats::close(const Bucket &bucket)
+{
+    if (bucket.count == 0)
+        return;
+
+    while (!minima.empty() && minima.back().value >= bucket.min)
+        minima.pop_back();
+    minima.push_back(Extreme{bucket.index, bucket.min});
+
+    while (!maxima.empty() && maxima.back().value <= bucket.max)
+        maxima.pop_back();
+    maxima.push_back(Extreme{bucket.index, bucket.max});
+}
+
+double WindowStats::mean() const
+{
+    return total.count > 0 ? offset + total.sum / total.count : 0.0;
+}
+
+double WindowStats::stddev() const
+{
+    if (total.count < 2)
+        return 0.0;
+
+    double m = total.sum / total.count;
+    double variance = total.sumSq / total.count - m * m;
+    return variance > 0 ? std::sqrt(variance) : 0.0;
+}
+
+double WindowStats::min() const
+{
+    if (total.count == 0)
+        return 0.0;
+
+    const Bucket &open = ring[current % ring.size()];
+    if (minima.empty())
+        return open.min;
+    return open.count > 0 ? std::min(open.min, minima.front().value) : minima.front().value;
+}
+
+double WindowStats::max() const
+{
+    if (total.count == 0)
+        return 0.0;
+
+    const Bucket &open = ring[current % ring.size()];
+    if (maxima.empty())
+        return open.max;
+    return open.count > 0 ? std::max(open.max, maxima.front().value) : maxima.front().value;
+}
+
+P2Quantile::P2Quantile(double quantile)
+{
+    setQuantile(quantile);
+}
+
+void P2Quantile::setQuantile(double quantile)
+{
+    p = std::min(std::max(quantile, 0.0), 1.0);
+    reset();
+}
+
+void P2Quantile::reset()
+{
+    total = 0;
+    for (int i = 0; i < 5; i++)
+        positions[i] = i + 1;
+
+    desired[0] = 1;
+    desired[1] = 1 + 2 * p;
+    desired[2] = 1 + 4 * p;
+    desired[3] = 3 + 2 * p;
+    desired[4] = 5;
+
+    increments[0] = 0;
+    increments[1] = p / 2;
+    increments[2] = p;
+    increments[3] = (1 + p) / 2;
+    increments[4] = 1;
+}
+
+void P2Quantile::add(double value)
+{
+    // The first five samples are the markers
+    if (total < 5)
+    {
+        heights[total++] = value;
+        if (total == 5)
+            std::sort(heights, heights + 5);
+        return;
+    }
+    total++;
+
+    // Cell of the new sample, extending the extremes
+    int k;
+    if (value < heights[0])
+    {
+        heights[0] = value;
+        k = 0;
+    }
+    else if (value >= heights[4])
+    {
+        heights[4] = value;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (k < 3 && value >= heights[k + 1])
+            k++;
+    }
+
+    for (int i = k + 1; i < 5; i++)
+        positions[i]++;
+    for (int i = 0; i < 5; i++)
+        desired[i] += increments[i];
+
+    // Move the middle markers that drifted a whole position off
+    for (int i = 1; i < 4; i++)
+    {
+        double offset = desired[i] - positions[i];
+        if ((offset >= 1 && positions[i + 1] - positions[i] > 1) ||
+                (offset <= -1 && positions[i - 1] - positions[i] < -1))
+        {
+            int d = offset > 0 ? 1 : -1;
+            double height = parabolic(i, d);
+            if (heights[i - 1] < height && height < heights[i + 1])
+                heights[i] = height;
+            else
+                heights[i] = linear(i, d);
+            positions[i] += d;
+        }
+    }
+}
+
+double P2Quantile::parabolic(int i, double d) const
+{
+    return heights[i] + d / (positions[i + 1] - positions[i - 1]) *
+           ((positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+            (positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+}
+
+double P2Quantile::linear(int i, int d) const
+{
+    return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+}
+
+P2QuantileState P2Quantile::save() const
+{
+    P2QuantileState state;
+    std::copy(heights, heights + 5, state.heights);
+    std::copy(positions, positions + 5, state.positions);
+    std::copy(desired, desired + 5, state.desired);
+    state.total = total;
+    return state;
+}
+
+bool P2Quantile::restore(const P2QuantileState &state)
+{
+    // Increments depend only on the quantile and stay as they are
+    reset();
+
+    bool valid = true;
+    for (int i = 0; i < 5; i++)
+        valid &= std::isfinite(state.heights[i]) && std::isfinite(state.positions[i]) && std::isfinite(state.desired[i]);
+
+    // Once running, markers are ordered and span every sample seen
+    if (valid && state.total >= 5)
+    {
+        valid = state.positions[0] == 1 && state.positions[4] == static_cast<double>(state.total);
+        for (int i = 0; i < 4; i++)
+            valid &= state.positions[i] < state.positions[i + 1] && state.heights[i] <= state.heights[i + 1];
+    }
+    if (!valid)
+        return false;
+
+    std::copy(state.heights, state.heights + 5, heights);
+    std::copy(state.positions, state.positions + 5, positions);
+    std::copy(state.desired, state.desired + 5, desired);
+    total = state.total;
+    return true;
+}
+
+double P2Quantile::value() const
+{
+    if (total >= 5)
+        return heights[2];
+    if (total == 0)
+        return 0.0;
+
+    // Exact quantile of the few samples seen so far
+    double sorted[5];
+    std::copy(heights, heights + total, sorted);
+    std::sort(sorted, sorted + total);
+    double rank = p * (total - 1);
+    size_t below = static_cast<size_t>(rank);
+    if (below + 1 >= total)
+        return sorted[total - 1];
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
@@ -0,0 +1,199 @@
+/*
+    Streaming statistics for the weather drivers
+
+    Constant-memory estimators fed from the sample path.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ * @brief Rolling statistics of the last WINDOW inter-arrival intervals.
+ */
+class IntervalStats
+{
+    public:
+        static constexpr size_t WINDOW = 64;
+
+        void add(double interval);
+        void reset();
+
+        size_t count() const
+        {
+            return filled;
+        }
+        double mean() const;
+        double stddev() const;
+        double max() const;
+
+    private:
+        double intervals[WINDOW] = {0};
+        size_t next = 0;
+        size_t filled = 0;
+        double sum = 0;
+        double sumSq = 0;
+};
+
+/**
+ * @brief Fixed-bucket log-scale latency histogram.
+ *
+ * Four buckets per power of two of nanoseconds, so any percentile is known
+ * to within 25 %, for 2 KiB of counters. Recording is a handful of integer
+ * operations and never allocates.
+ */
+class LatencyHistogram
+{
+    public:
+        void record(int64_t nanoseconds);
+        void reset();
+
+        uint64_t count() const
+        {
+            return total;
+        }
+        /** @brief Upper bound of the bucket holding the given quantile (0-1), in ns. */
+        int64_t percentile(double quantile) const;
+        int64_t max() const
+        {
+            return maximum;
+        }
+
+    private:
+        static constexpr int SUB_BUCKETS = 4;
+        static constexpr size_t BUCKETS = 64 * SUB_BUCKETS;
+
+        static size_t bucketOf(uint64_t value);
+        static uint64_t bucketUpperBound(size_t bucket);
+
+        uint64_t buckets[BUCKETS] = {0};
+        uint64_t total = 0;
+        int64_t maximum = 0;
+};
+
+/**
+ * @brief Min, max, mean and stddev of the samples of the last few minutes.
+ *
+ * Samples are summed into time buckets held in a ring: 1 s wide, or wider
+ * for windows longer than MAX_BUCKETS seconds. Running sums give the mean
+ * and stddev, and monotonic deques of the closed buckets give the min and
+ * max. A sample costs the same whatever the window length. Moving to a
+ * new bucket costs one step per elapsed bucket. The window edge is exact
+ * to within one bucket.
+ */
+class WindowStats
+{
+    public:
+        static constexpr size_t MAX_BUCKETS = 900;
+
+        /** @brief Window length in seconds, clears the statistics. */
+        void setWindow(double seconds);
+        double window() const
+        {
+            return bucketWidth * ring.size();
+        }
+
+        /** @param now monotonic time in seconds. */
+        void add(double value, double now);
+
+        /** @brief Drop samples that left the window, for when samples stop coming. */
+        void expire(double now);
+
+        void reset();
+
+        size_t count() const
+        {
+            return total.count;
+        }
+        double mean() const;
+        double stddev() const;
+        double min() const;
+        double max() const;
+
+    private:
+        struct Bucket
+        {
+            int64_t index = -1;     // bucket number since the clock epoch, -1 = empty
+            size_t count = 0;
+            double sum = 0;         // relative to offset, keeps the variance accurate
+            double sumSq = 0;
+            double min = 0;
+            double max = 0;
+        };
+        struct Extreme
+        {
+            int64_t index;
+            double value;
+        };
+
+        void advance(int64_t index);
+        void close(const Bucket &bucket);
+
+        std::vector<Bucket> ring;
+        double bucketWidth = 1;
+        int64_t current = -1;       // bucket receiving samples
+        double offset = 0;
+        Bucket total;
+        std::deque<Extreme> minima; // closed buckets, values increasing
+        std::deque<Extreme> maxima; // closed buckets, values decreasing
+};
+
+/** @brief Marker state of a P2Quantile as plain data, e.g. for a state file. */
+struct P2QuantileState
+{
+    double heights[5];
+    double positions[5];
+    double desired[5];
+    uint64_t total;
+};
+
+/**
+ * @brief Streaming estimate of one quantile, P² algorithm (Jain & Chlamtac).
+ *
+ * Five markers track the minimum, the quantile, the maximum and the two
+ * midpoints between them. Each sample moves the markers with a parabolic
+ * fit, so memory and cost per sample are constant however long it runs.
+ */
+class P2Quantile
+{
+    public:
+        explicit P2Quantile(double quantile = 0.5);
+
+        /** @brief Quantile to estimate (0-1), clears the estimate. */
+        void setQuantile(double quantile);
+
+        void add(double value);
+        void reset();
+
+        size_t count() const
+        {
+            return total;
+        }
+        /** @brief Current estimate, exact while fewer than five samples were seen. */
+        double value() const;
+
+        P2QuantileState save() const;
+
+        /**
+         * @brief Continue from a saved state of the same quantile.
+         * @return false and cleared when the state is not consistent.
+         */
+        bool restore(const P2QuantileState &state);
+
+    private:
+        double parabolic(int i, double d) const;
+        double linear(int i, int d) const;
+
+        double p;
+        double heights[5] = {0};    // marker values
+        double positions[5] = {0};  // actual marker positions, 1-based
+        double desired[5] = {0};    // desired marker positions
+        double increments[5] = {0}; // desired position change per sample
+        size_t total = 0;
+};
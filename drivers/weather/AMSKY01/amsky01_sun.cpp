@@ -0,0 +1,34 @@
+/*
+    Solar position for the AMSKY01 driver
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_sun.h"
+
+#include <cmath>
+
+double solarAltitude(double unixTime, double latitude, double longitude)
+{
+    const double rad = M_PI / 180.0;
+
+    // Days since J2000.0
+    double d = unixTime / 86400.0 + 2440587.5 - 2451545.0;
+
+    // Ecliptic longitude from the mean anomaly and the equation of centre
+    double g = (357.529 + 0.98560028 * d) * rad;
+    double q = 280.459 + 0.98564736 * d;
+    double lambda = (q + 1.915 * std::sin(g) + 0.020 * std::sin(2 * g)) * rad;
+    double epsilon = (23.439 - 0.00000036 * d) * rad;
+
+    double ra = std::atan2(std::cos(epsilon) * std::sin(lambda), std::cos(lambda));
+    double dec = std::asin(std::sin(epsilon) * std::sin(lambda));
+
+    // Local sidereal time and hour angle
+    double gmst = std::fmod(18.697374558 + 24.06570982441908 * d, 24.0);
+    double hourAngle = (gmst * 15.0 + longitude) * rad - ra;
+
+    double phi = latitude * rad;
+    return std::asin(std::sin(phi) * std::sin(dec) + std::cos(phi) * std::cos(dec) * std::cos(hourAngle)) / rad;
+}
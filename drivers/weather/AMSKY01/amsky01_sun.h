@@ -0,0 +1,22 @@
+/*
+    Solar position for the AMSKY01 driver
+
+    Low precision solar altitude, good to about 0.1 degree, enough to tell
+    day from night without an ephemeris library.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#pragma once
+
+/** @brief Altitude of the Sun's centre at sunrise and sunset, refraction and semi-diameter included. */
+constexpr double SUNSET_ALTITUDE = -0.833;
+
+/**
+ * @brief Altitude of the Sun in degrees.
+ * @param unixTime UTC seconds since 1970.
+ * @param latitude degrees, north positive.
+ * @param longitude degrees, east positive (0-360 or -180-180).
+ */
+double solarAltitude(double unixTime, double latitude, double longitude);
@@ -0,0 +1,233 @@
+/*
+    AMSKY01 parser and ingest core microbenchmark
+
+    Measures the cost per line of sentence parsing, of the protocol core of
+    the ingest path from raw bytes to filtered values, and of the API JSON
+    parser.
+    Every result is one JSON object per line on stdout:
+
+        {"benchmark":"parse_hygro","ns_per_op":41.2,"ops":2000000,"runs":7}
+
+    ns_per_op is the median of the runs. Usage: bench_amsky01 [ops per run]
+
+    A few sanity checks of the measured code run first; the benchmark exits
+    with status 1 and a message on stderr if one fails.
+
+    Author: Roman Dvořák <info@astrometers.cz>
+    Copyright (C) 2025 Astrometers
+*/
+
+#include "amsky01_protocol.h"
+#include "amsky01_filter.h"
+#include "amsky01_api_json.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace AMSKY01Protocol;
+
+namespace
+{
+
+constexpr int RUNS = 7;
+
+// Keeps results alive so the compiler cannot drop the measured work
+volatile double sink;
+
+template <typename Body>
+void run(const char *name, size_t ops, Body &&body)
+{
+    std::vector<double> results;
+    for (int i = 0; i < RUNS; i++)
+    {
+        int64_t start = monotonicNs();
+        body(ops);
+        results.push_back(static_cast<double>(monotonicNs() - start) / ops);
+    }
+
+    std::sort(results.begin(), results.end());
+    printf("{\"benchmark\":\"%s\",\"ns_per_op\":%.2f,\"ops\":%zu,\"runs\":%d}\n",
+           name, results[RUNS / 2], ops, RUNS);
+    fflush(stdout);
+}
+
+// Representative lines with varying values, as the firmware prints them
+std::vector<std::string> sampleLines(SentenceType type)
+{
+    std::vector<std::string> lines;
+    char line[256];
+    for (int i = 0; i < 64; i++)
+    {
+        switch (type)
+        {
+            case SentenceType::HYGRO:
+                snprintf(line, sizeof(line), "$hygro,%.2f,%.2f", 8.5 + i * 0.13, 61.0 + i * 0.4);
+                break;
+            case SentenceType::LIGHT:
+                snprintf(line, sizeof(line), "$light,%.4f,%d,%d,%d,%d", 0.0123 + i * 0.001, 120 + i, 48 + i, 9876, 600);
+                break;
+            default:
+                snprintf(line, sizeof(line), "$cloud,%.2f,%.2f,%.2f,%.2f,%.2f",
+                         64310.0 + i, 64342.5 + i, 64288.0 + i, 64301.25 + i, 64210.75 + i);
+                break;
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void benchParse(const char *name, SentenceType type, size_t ops)
+{
+    std::vector<std::string> lines = sampleLines(type);
+
+    run(name, ops, [&lines](size_t n)
+    {
+        Sentence sentence;
+        double sum = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            const std::string &line = lines[i & 63];
+            parseSentence(line.data(), line.size(), sentence);
+            sum += sentence.outputs[0];
+        }
+        sink = sum;
+    });
+}
+
+/**
+ * Protocol core of the ingest path: read() sized chunks go through the
+ * framer, parser, frame assembler and publish filter into a sink. The
+ * driver does more per line (statistics, cloud onset, history, snapshot
+ * and archive), so this is a lower bound, not the driver's cost.
+ */
+void benchIngestCore(size_t ops)
+{
+    std::string stream;
+    std::vector<std::string> types[SENTENCE_COUNT] =
+    {
+        sampleLines(SentenceType::HYGRO), sampleLines(SentenceType::LIGHT), sampleLines(SentenceType::CLOUD)
+    };
+    for (size_t i = 0; i < 64; i++)
+        for (const std::vector<std::string> &lines : types)
+            stream.append(lines[i]).append("\r\n");
+
+    run("ingest_core", ops, [&stream](size_t n)
+    {
+        // Chunk size of a typical read() from a USB serial adapter
+        const size_t CHUNK = 256;
+
+        LineFramer framer;
+        FrameAssembler frames;
+        PublishFilter filter;
+        filter.resize(PARAMETER_COUNT);
+        for (size_t i = 0; i < PARAMETER_COUNT; i++)
+            filter.setDeadband(i, 0.01, 0);
+
+        size_t lines = 0, published = 0;
+        double sum = 0;
+        int64_t now = 0;
+
+        while (lines < n)
+        {
+            for (size_t offset = 0; offset < stream.size() && lines < n; offset += CHUNK)
+            {
+                framer.write(stream.data() + offset, std::min(CHUNK, stream.size() - offset));
+                lines += framer.drain([&](const char *line, size_t length)
+                {
+                    Sentence sentence;
+                    if (parseSentence(line, length, sentence) != ParseResult::OK)
+                        return;
+                    if (!frames.add(sentence, now))
+                        return;
+
+                    const Frame &frame = frames.close();
+                    now += 1000000000;
+                    for (size_t i = 0; i < PARAMETER_COUNT; i++)
+                    {
+                        if (filter.update(i, frame.values[i], now / 1e9))
+                        {
+                            sum += frame.values[i];
+                            published++;
+                        }
+                    }
+                });
+            }
+        }
+        sink = sum + published;
+    });
+}
+
+// A value restored at a warm start survives a first frame its sensor is missing from
+bool checkSeededFrame()
+{
+    FrameAssembler frames;
+    double restored[MAX_OUTPUTS] = { 7.5, 83.0, 4.8 };
+    frames.seed(SentenceType::HYGRO, restored);
+
+    Sentence sentence;
+    const char line[] = "$light,0.0123,120,48,9876,600";
+    if (parseSentence(line, sizeof(line) - 1, sentence) != ParseResult::OK)
+        return false;
+    frames.add(sentence, 0);
+
+    const Frame &frame = frames.close();
+    const SentenceSpec &hygro = SENTENCES[static_cast<size_t>(SentenceType::HYGRO)];
+    for (size_t i = 0; i < hygro.outputCount; i++)
+        if (frame.values[hygro.outputs[i]] != restored[i])
+            return false;
+    return frame.updated == 1u << static_cast<size_t>(SentenceType::LIGHT);
+}
+
+void benchApiJson(const char *name, const std::string &payload, size_t ops)
+{
+    run(name, ops, [&payload](size_t n)
+    {
+        AMSKY01ApiData data;
+        std::string error;
+        double sum = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            parseApiJson(payload, data, error);
+            sum += data.temperature;
+        }
+        sink = sum;
+    });
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ops = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    if (ops == 0)
+        ops = 1000000;
+
+    if (!checkSeededFrame())
+    {
+        fprintf(stderr, "check failed: restored values lost in a partial frame\n");
+        return 1;
+    }
+
+    benchParse("parse_hygro", SentenceType::HYGRO, ops);
+    benchParse("parse_light", SentenceType::LIGHT, ops);
+    benchParse("parse_cloud", SentenceType::CLOUD, ops);
+    benchIngestCore(ops);
+
+    // data.json as served by amsky01_viewer.py, and a document with only hygro
+    const std::string full =
+        "{\"timestamp\":\"2025-11-02T21:14:07Z\","
+        "\"hygro\":{\"temp\":8.73,\"rh\":71.4,\"dew_point\":3.81,\"age\":0.4},"
+        "\"light\":{\"lux\":0.0123,\"sqm\":20.91,\"raw1\":121,\"raw2\":49,\"gain\":9876,\"integration\":600,\"age\":0.9},"
+        "\"cloud\":{\"t1\":-21.4,\"t2\":-20.9,\"t3\":-22.1,\"t4\":-21.7,\"center\":-24.3,\"cover\":4.2,\"age\":0.2}}";
+    const std::string partial = "{\"hygro\":{\"temp\":8.73,\"rh\":71.4,\"dew_point\":3.81}}";
+
+    // JSON is two orders of magnitude slower, keep the run time comparable
+    size_t jsonOps = std::max<size_t>(ops / 100, 1);
+    benchApiJson("api_json_full", full, jsonOps);
+    benchApiJson("api_json_partial", partial, jsonOps);
+
+    return 0;
+}